@@ -0,0 +1,135 @@
+// CRC microbenchmark - host build only, see `make bench`
+//
+// Checks the generated tables against the bitwise algorithm and times the byte wide CRC8
+// against the previous 2x16 nibble table, plus the incremental scratch pad update.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ow_crc.h"
+
+#define BUF_LEN (64 * 1024)
+#define SCRATCH_LEN 9
+
+static volatile uint32_t sink;
+
+static const uint8_t dscrc2x16_table[] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83,
+    0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8,
+    0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
+};
+
+static uint8_t crc8_nibble(const uint8_t *addr, uint32_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc = *addr++ ^ crc;
+        crc = dscrc2x16_table[crc & 0x0f] ^ dscrc2x16_table[16 + ((crc >> 4) & 0x0f)];
+    }
+    return crc;
+}
+
+static uint8_t crc8_bitwise(const uint8_t *addr, uint32_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t b = *addr++;
+        for (int i = 0; i < 8; i++, b >>= 1) {
+            crc = ((crc ^ b) & 1) ? (crc >> 1) ^ OW_CRC8_POLY : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16_bitwise(const uint8_t *addr, uint32_t len, uint16_t crc) {
+    while (len--) {
+        uint8_t b = *addr++;
+        for (int i = 0; i < 8; i++, b >>= 1) {
+            crc = ((crc ^ b) & 1) ? (crc >> 1) ^ OW_CRC16_POLY : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, double ns, double bytes) {
+    printf("  %-28s %8.3f ns/byte %10.1f MB/s\n", name, ns / bytes, bytes * 1e3 / ns);
+}
+
+int main(int argc, char **argv) {
+    int iters = argc > 1 ? atoi(argv[1]) : 200;
+    uint8_t *buf = malloc(BUF_LEN);
+    int errors = 0;
+
+    srand(1);
+    for (int i = 0; i < BUF_LEN; i++) buf[i] = rand();
+
+    // correctness first
+    for (int i = 0; i < 256; i++) {
+        uint8_t b = i;
+        if (crc8_bitwise(&b, 1) != crc8(&b, 1) || crc8_nibble(&b, 1) != crc8(&b, 1)) errors++;
+        if (crc16_bitwise(&b, 1, 0) != crc16(&b, 1, 0)) errors++;
+    }
+    if (crc8_bitwise(buf, BUF_LEN) != crc8_update(0, buf, BUF_LEN)) errors++;
+    if (crc16_bitwise(buf, BUF_LEN, 0) != crc16(buf, BUF_LEN, 0)) errors++;
+    printf("crc_bench: table check %s\n", errors ? "FAILED" : "ok");
+
+    double t;
+    double bytes = (double)BUF_LEN * iters;
+
+    t = now_ns();
+    for (int i = 0; i < iters; i++) sink += crc8_update(0, buf, BUF_LEN);
+    report("crc8 byte table", now_ns() - t, bytes);
+
+    t = now_ns();
+    for (int i = 0; i < iters; i++) sink += crc8_nibble(buf, BUF_LEN);
+    report("crc8 2x16 nibble table", now_ns() - t, bytes);
+
+    t = now_ns();
+    for (int i = 0; i < iters / 8 + 1; i++) sink += crc8_bitwise(buf, BUF_LEN);
+    report("crc8 bitwise", now_ns() - t, (double)BUF_LEN * (iters / 8 + 1));
+
+    t = now_ns();
+    for (int i = 0; i < iters; i++) sink += crc16(buf, BUF_LEN, 0);
+    report("crc16 byte table", now_ns() - t, bytes);
+
+    // scratch pad sized updates, as done by the chip on every write scratchpad
+    uint8_t sp[SCRATCH_LEN] = {0};
+    uint8_t prefix[SCRATCH_LEN] = {0};
+    int n = BUF_LEN * iters / SCRATCH_LEN;
+
+    t = now_ns();
+    for (int i = 0; i < n; i++) {
+        sp[2] = i;
+        sp[8] = crc8(sp, SCRATCH_LEN - 1);
+    }
+    sink += sp[8];
+    double full = now_ns() - t;
+    printf("  %-28s %8.3f ns/update\n", "scratch pad full", full / n);
+
+    for (int i = 0; i < SCRATCH_LEN - 1; i++) prefix[i + 1] = crc8_byte(prefix[i], sp[i]);
+    t = now_ns();
+    for (int i = 0; i < n; i++) {
+        sp[2] = i;
+        uint8_t crc = prefix[2];
+        for (int j = 2; j < SCRATCH_LEN - 1; j++) {
+            crc = crc8_byte(crc, sp[j]);
+            prefix[j + 1] = crc;
+        }
+        sp[8] = crc;
+    }
+    sink += sp[8];
+    printf("  %-28s %8.3f ns/update\n", "scratch pad from offset 2", (now_ns() - t) / n);
+
+    free(buf);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+// Minimal JSON reader - recursive descent into a tree of json_t
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "json.h"
+
+typedef struct {
+    const char *start;
+    const char *p;
+    int error;
+} parser_t;
+
+static json_t *parse_value(parser_t *ps);
+
+static void skip_ws(parser_t *ps) {
+    while (isspace((unsigned char)*ps->p)) ps->p++;
+}
+
+static json_t *fail(parser_t *ps, const char *what) {
+    if (!ps->error) {
+        fprintf(stderr, "json: %s at offset %ld\n", what, (long)(ps->p - ps->start));
+    }
+    ps->error = 1;
+    return NULL;
+}
+
+static json_t *node(json_type_t type) {
+    json_t *j = calloc(1, sizeof(json_t));
+    j->type = type;
+    return j;
+}
+
+static char *parse_string(parser_t *ps) {
+    // the decoded string is never longer than the source
+    const char *end = ps->p + 1;
+    while (*end && *end != '"') end += *end == '\\' && end[1] ? 2 : 1;
+    if (*end != '"') {
+        fail(ps, "unterminated string");
+        return NULL;
+    }
+
+    char *s = malloc(end - ps->p);
+    char *d = s;
+    for (ps->p++; ps->p < end; ps->p++) {
+        if (*ps->p != '\\') {
+            *d++ = *ps->p;
+            continue;
+        }
+        switch (*++ps->p) {
+            case 'n': *d++ = '\n'; break;
+            case 't': *d++ = '\t'; break;
+            case 'r': *d++ = '\r'; break;
+            case 'b': *d++ = '\b'; break;
+            case 'f': *d++ = '\f'; break;
+            case 'u':
+                // only the ASCII range is of interest here
+                *d++ = (char)strtol((char[5]){ps->p[1], ps->p[2], ps->p[3], ps->p[4], 0}, NULL, 16);
+                ps->p += 4;
+                break;
+            default: *d++ = *ps->p; break;
+        }
+    }
+    *d = 0;
+    ps->p = end + 1;
+    return s;
+}
+
+static json_t *parse_container(parser_t *ps, json_type_t type, char close) {
+    json_t *j = node(type);
+    json_t **tail = &j->child;
+
+    ps->p++;
+    skip_ws(ps);
+    if (*ps->p == close) {
+        ps->p++;
+        return j;
+    }
+    for (;;) {
+        char *key = NULL;
+        skip_ws(ps);
+        if (type == JSON_OBJ) {
+            if (*ps->p != '"') break;
+            key = parse_string(ps);
+            skip_ws(ps);
+            if (key == NULL || *ps->p != ':') {
+                free(key);
+                break;
+            }
+            ps->p++;
+        }
+        json_t *v = parse_value(ps);
+        if (v == NULL) {
+            free(key);
+            break;
+        }
+        v->key = key;
+        *tail = v;
+        tail = &v->next;
+
+        skip_ws(ps);
+        if (*ps->p == ',') {
+            ps->p++;
+            continue;
+        }
+        if (*ps->p == close) {
+            ps->p++;
+            return j;
+        }
+        break;
+    }
+    json_free(j);
+    return fail(ps, type == JSON_OBJ ? "bad object" : "bad array");
+}
+
+static json_t *parse_value(parser_t *ps) {
+    skip_ws(ps);
+    switch (*ps->p) {
+        case '{': return parse_container(ps, JSON_OBJ, '}');
+        case '[': return parse_container(ps, JSON_ARR, ']');
+        case '"': {
+            char *s = parse_string(ps);
+            if (s == NULL) return NULL;
+            json_t *j = node(JSON_STR);
+            j->str = s;
+            return j;
+        }
+        default:
+            break;
+    }
+    if (!strncmp(ps->p, "true", 4) || !strncmp(ps->p, "false", 5)) {
+        json_t *j = node(JSON_BOOL);
+        j->num = *ps->p == 't';
+        ps->p += j->num ? 4 : 5;
+        return j;
+    }
+    if (!strncmp(ps->p, "null", 4)) {
+        ps->p += 4;
+        return node(JSON_NULL);
+    }
+    char *end;
+    double v = strtod(ps->p, &end);
+    if (end == ps->p) {
+        return fail(ps, "unexpected character");
+    }
+    ps->p = end;
+    json_t *j = node(JSON_NUM);
+    j->num = v;
+    return j;
+}
+
+json_t *json_parse(const char *text) {
+    parser_t ps = {text, text, 0};
+    json_t *j = parse_value(&ps);
+    skip_ws(&ps);
+    if (j != NULL && *ps.p) {
+        json_free(j);
+        return fail(&ps, "trailing characters");
+    }
+    return j;
+}
+
+json_t *json_load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *text = malloc(len + 1);
+    text[fread(text, 1, len, f)] = 0;
+    fclose(f);
+
+    json_t *j = json_parse(text);
+    free(text);
+    return j;
+}
+
+void json_free(json_t *j) {
+    while (j != NULL) {
+        json_t *next = j->next;
+        json_free(j->child);
+        free(j->key);
+        free(j->str);
+        free(j);
+        j = next;
+    }
+}
+
+json_t *json_get(const json_t *j, const char *key) {
+    if (j == NULL || j->type != JSON_OBJ) {
+        return NULL;
+    }
+    for (json_t *c = j->child; c; c = c->next) {
+        if (!strcmp(c->key, key)) return c;
+    }
+    return NULL;
+}
+
+const char *json_text(const json_t *j, char *buf, int len) {
+    if (j == NULL) {
+        return NULL;
+    }
+    if (j->type == JSON_STR) {
+        return j->str;
+    }
+    if (j->type == JSON_NUM || j->type == JSON_BOOL) {
+        snprintf(buf, len, "%.15g", j->num);
+        return buf;
+    }
+    return NULL;
+}
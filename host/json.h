@@ -0,0 +1,38 @@
+//
+// Minimal JSON reader for the host build, enough for diagram.json and host scripts.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_JSON_H
+#define WOKWI_DS1820_CUSTOM_CHIP_JSON_H
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUM,
+    JSON_STR,
+    JSON_ARR,
+    JSON_OBJ,
+} json_type_t;
+
+typedef struct json {
+    json_type_t type;
+    char *key;              // member name when the parent is an object
+    char *str;              // JSON_STR
+    double num;             // JSON_NUM, JSON_BOOL
+    struct json *child;     // first element or member
+    struct json *next;
+} json_t;
+
+// returns NULL and prints where it stopped on a syntax error
+json_t *json_parse(const char *text);
+json_t *json_load(const char *path);
+void json_free(json_t *j);
+// member of an object, NULL if it's missing or j is not an object
+json_t *json_get(const json_t *j, const char *key);
+// string or number as text, NULL for other types. Numbers are formatted into buf
+const char *json_text(const json_t *j, char *buf, int len);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_JSON_H
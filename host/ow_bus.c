@@ -0,0 +1,199 @@
+// Bus scaling benchmark for the host build - N chips with unique ROM ids on one DQ net under a master
+// running search, match and convert cycles, for each N of a list. Reports the wall time per
+// simulated second and per device, to find the per device cost of large diagrams.
+//
+//   ow_bus [-N 1,10,100,1000,10000] [-c cycles] [-w conversion wait ms] [-a name=value]... [-H] [-v]
+//
+// A cycle is one search ROM pass, which finds the next device in ROM order, then a match ROM and
+// convert T for the device found and a match ROM and read scratchpad for it. Every N runs in a
+// process of its own, so the chips of one run don't add to the memory and the kernel of the next.
+// -H keeps the chip timers on the event heap instead of the timing wheel.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "sim.h"
+#include "ow_master.h"
+#include "ow_crc.h"
+
+#define MAX_RUNS        16
+#define MAX_OVERRIDES   16
+
+static long max_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_bus [-N n,n,...] [-c cycles] [-w conversion wait ms] [-a name=value]... [-H] [-v]\n");
+    exit(2);
+}
+
+typedef struct {
+    long cycles;
+    uint64_t conv_wait_ns;
+    const char *overrides[MAX_OVERRIDES];
+    int num_overrides;
+    bool verbose;
+} bus_cfg_t;
+
+static int id_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// the device with the given ROM, -1 if it's none of ours
+static long find_device(const uint64_t *ids, long n, const uint8_t rom[8]) {
+    uint64_t id = ow_master_rom_id(rom);
+    const uint64_t *p = bsearch(&id, ids, n, sizeof(uint64_t), id_cmp);
+    return p ? p - ids : -1;
+}
+
+static int run(long n, const bus_cfg_t *cfg, int out) {
+    long base_kb = max_rss_kb();
+    sim_net_t dq = sim_net_new("DQ");
+    sim_net_t vcc = sim_net_new("VCC");
+    sim_net_force(vcc, HIGH);
+
+    uint64_t *ids = malloc(n * sizeof(uint64_t));
+    uint8_t *found = calloc(n, 1);
+    double t0 = sim_wall_s();
+    for (long i = 0; i < n; i++) {
+        char name[32], id[16];
+        snprintf(name, sizeof(name), "ds%ld", i);
+        sim_chip_t *chip = sim_chip_new(name);
+        ids[i] = ow_master_dev_id(i);
+        snprintf(id, sizeof(id), "%012llx", (unsigned long long)ids[i]);
+        sim_chip_attr(chip, "deviceID", id);
+        sim_chip_attr(chip, "genDebug", "0");
+        for (int j = 0; j < cfg->num_overrides; j++) {
+            if (sim_chip_attr_arg(chip, cfg->overrides[j]) < 0) usage();
+        }
+        sim_chip_bind(chip, "DQ", dq);
+        sim_chip_bind(chip, "VCC", vcc);
+        sim_chip_call(chip, chip_init);
+    }
+    double init_s = sim_wall_s() - t0;
+    qsort(ids, n, sizeof(uint64_t), id_cmp);
+
+    sim_net_pullup(dq, true);
+    ow_master_t m;
+    ow_master_init(&m, dq);
+    int errors = 0;
+    long unique = 0;
+    uint64_t sim_t0 = sim_now();
+    uint64_t ev0 = sim_events();
+    t0 = sim_wall_s();
+
+    for (long c = 0; c < cfg->cycles; c++) {
+        uint8_t rom[8];
+        if (ow_master_search(&m, rom) != 1 || crc8(rom, 7) != rom[7]) {
+            fprintf(stderr, "%ld devices: search failed in cycle %ld\n", n, c);
+            errors++;
+            continue;
+        }
+        long dev = find_device(ids, n, rom);
+        if (dev < 0) {
+            fprintf(stderr, "%ld devices: search found an unknown ROM in cycle %ld\n", n, c);
+            errors++;
+            continue;
+        }
+        unique += !found[dev];
+        found[dev] = 1;
+
+        uint8_t cmd[10] = {0x55};
+        memcpy(cmd + 1, rom, 8);
+        cmd[9] = 0x44;
+        ow_master_reset(&m);
+        ow_master_write(&m, cmd, 10);
+        ow_master_delay(&m, cfg->conv_wait_ns);
+
+        cmd[9] = 0xBE;
+        ow_master_rx_clear(&m);
+        ow_master_reset(&m);
+        ow_master_write(&m, cmd, 10);
+        ow_master_read(&m, 9);
+        sim_run_until(m.t);
+        if (crc8(m.rx, 8) != m.rx[8]) {
+            fprintf(stderr, "%ld devices: bad scratchpad crc in cycle %ld\n", n, c);
+            errors++;
+        }
+    }
+    double dt = sim_wall_s() - t0;
+    double sim_s = (sim_now() - sim_t0) / 1e9;
+    long rss_kb = max_rss_kb();
+
+    fflush(stdout);
+    dprintf(out, "%7ld %8.3f %7ld %8.3f %9.3f %11.2f %12.3f %10llu %8.2f %7ld %s\n", n, init_s, cfg->cycles, sim_s,
+            dt, dt / sim_s * 1e3, dt / sim_s / n * 1e6, (unsigned long long)(sim_events() - ev0),
+            (double)(rss_kb - base_kb) / n, unique, errors || m.presences != m.resets ? "FAIL" : "ok");
+    free(ids);
+    free(found);
+    return errors || m.presences != m.resets;
+}
+
+int main(int argc, char **argv) {
+    const char *sizes = "1,10,100,1000,10000";
+    bus_cfg_t cfg = {.cycles = 10, .conv_wait_ns = 750000000ull};
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) {
+            cfg.verbose = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "-H")) {
+            sim_timer_heap(true);
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-N")) sizes = argv[++i];
+        else if (!strcmp(argv[i], "-c")) cfg.cycles = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-w")) cfg.conv_wait_ns = (uint64_t)(atof(argv[++i]) * 1e6);
+        else if (!strcmp(argv[i], "-a") && cfg.num_overrides < MAX_OVERRIDES) cfg.overrides[cfg.num_overrides++] = argv[++i];
+        else usage();
+    }
+
+    long runs[MAX_RUNS];
+    int num_runs = 0;
+    for (const char *p = sizes; *p && num_runs < MAX_RUNS; p += *p == ',') {
+        char *end;
+        runs[num_runs] = strtol(p, &end, 10);
+        if (end == p || runs[num_runs] <= 0) usage();
+        num_runs++;
+        p = end;
+    }
+    if (num_runs == 0 || cfg.cycles <= 0) usage();
+
+    printf("devices   init s  cycles    sim s    wall s  ms/sim s  us/dev/sim s     events  KB/dev   found\n");
+    fflush(stdout);
+    int failed = 0;
+    for (int i = 0; i < num_runs; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            // the chips log to stdout, the result line goes to the original one
+            int out = dup(STDOUT_FILENO);
+            if (!cfg.verbose) freopen("/dev/null", "w", stdout);
+            exit(run(runs[i], &cfg, out));
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if (!WIFEXITED(status)) printf("%7ld killed by signal %d\n", runs[i], WTERMSIG(status));
+            failed++;
+        }
+    }
+    return failed != 0;
+}
@@ -0,0 +1,283 @@
+// Native host runner - loads a diagram, runs the chip under a scripted bus master and reports the
+// kernel throughput. Build with `make host`, run under perf or valgrind as needed.
+//
+//   ow_host [-d diagram.json] [-t chip-ds18b20] [-n transactions] [-a name=value]... [-H] [-v]
+//   ow_host -k events         kernel only benchmark
+//   ow_host -T expiries       timer queue benchmark, timing wheel against heap at 10k and 100k timers
+//
+// -H keeps the chip timers on the event heap rather than the timing wheel, the output must not change.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "ow_master.h"
+#include "ow_crc.h"
+
+#define MAX_CHIPS       16
+#define MAX_OVERRIDES   16
+#define CONV_WAIT_NS    750000000ull
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_host [-d diagram.json] [-t chip type] [-n transactions] [-a name=value]... [-H] [-v]\n"
+                    "       ow_host -k events\n"
+                    "       ow_host -T expiries\n");
+    exit(2);
+}
+
+// ==================== kernel benchmark =========================
+
+typedef struct {
+    uint32_t lcg;
+    uint64_t left;
+} bench_proc_t;
+
+static void bench_step(void *arg, uint32_t data) {
+    bench_proc_t *p = arg;
+    if (p->left == 0) {
+        return;
+    }
+    p->left--;
+    p->lcg = p->lcg * 1664525u + 1013904223u;
+    sim_at(sim_now() + 1 + (p->lcg >> 22), bench_step, p, data);
+}
+
+// a few hundred self rescheduling processes with random delays, like the timers of a bus full of chips
+static int kernel_bench(uint64_t events) {
+    enum { PROCS = 256 };
+    static bench_proc_t procs[PROCS];
+
+    sim_reset();
+    for (int i = 0; i < PROCS; i++) {
+        procs[i] = (bench_proc_t){(uint32_t)i * 2654435761u, events / PROCS};
+        sim_at(i, bench_step, &procs[i], 0);
+    }
+    double t0 = sim_wall_s();
+    sim_run();
+    double dt = sim_wall_s() - t0;
+    printf("kernel: %llu events in %.3f s, %.2f M events/s\n", (unsigned long long)sim_events(), dt,
+           sim_events() / dt / 1e6);
+    return 0;
+}
+
+// ==================== timer benchmark =========================
+
+static struct {
+    timer_t *timers;
+    uint32_t num;
+    uint32_t lcg;
+    uint64_t left;
+    uint64_t check;             // of the expiry order, the same for both queues
+} tb;
+
+// like a slot of a chip: restart the own timer, and stop and rearm another one before it expires
+static void tb_expired(void *user_data) {
+    if (tb.left == 0) {
+        return;
+    }
+    tb.left--;
+    uint32_t own = (uint32_t)(uintptr_t)user_data;
+    tb.check = (tb.check ^ sim_now() ^ own) * 0x100000001B3ull;
+    tb.lcg = tb.lcg * 1664525u + 1013904223u;
+    timer_start_ns(tb.timers[own], 1000 + (tb.lcg >> 12), false);
+    tb.lcg = tb.lcg * 1664525u + 1013904223u;
+    timer_t other = tb.timers[tb.lcg % tb.num];
+    timer_stop(other);
+    timer_start_ns(other, 1000 + (tb.lcg >> 12), false);
+}
+
+static double timer_bench_run(uint32_t num, bool heap, uint64_t expiries) {
+    sim_reset();
+    sim_timer_heap(heap);
+    tb.timers = realloc(tb.timers, num * sizeof(timer_t));
+    tb.num = num;
+    tb.lcg = 1;
+    tb.left = expiries;
+    tb.check = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        timer_config_t cfg = {.callback = tb_expired, .user_data = (void *)(uintptr_t)i};
+        tb.timers[i] = timer_init(&cfg);
+        tb.lcg = tb.lcg * 1664525u + 1013904223u;
+        timer_start_ns(tb.timers[i], 1000 + (tb.lcg >> 12), false);
+    }
+    double t0 = sim_wall_s();
+    sim_run();
+    return sim_wall_s() - t0;
+}
+
+// every expiry is a start, a stop and a start, with up to 1 ms between start and expiry
+static int timer_bench(uint64_t expiries) {
+    static const uint32_t sizes[] = {10000, 100000};
+    printf(" timers   queue   expiries     wall s  M expiries/s             check\n");
+    for (int i = 0; i < 2; i++) {
+        for (int heap = 1; heap >= 0; heap--) {
+            double dt = timer_bench_run(sizes[i], heap, expiries);
+            printf("%7u %7s %10llu %10.3f %13.2f  %016llx\n", sizes[i], heap ? "heap" : "wheel",
+                   (unsigned long long)expiries, dt, expiries / dt / 1e6, (unsigned long long)tb.check);
+        }
+    }
+    return 0;
+}
+
+// ==================== chip run =========================
+
+static void print_hex(const char *what, const uint8_t *buf, uint32_t len) {
+    printf("%s:", what);
+    for (uint32_t i = 0; i < len; i++) printf(" %02x", buf[i]);
+    printf("\n");
+}
+
+static int check_crc(const char *what, const uint8_t *buf, uint32_t len) {
+    if (crc8(buf, len - 1) == buf[len - 1]) {
+        return 0;
+    }
+    fprintf(stderr, "%s: bad crc at %.3f ms\n", what, sim_now() / 1e6);
+    return 1;
+}
+
+static bool read_scratchpad(ow_master_t *m, uint8_t sp[9]) {
+    ow_master_rx_clear(m);
+    ow_master_reset(m);
+    ow_master_write(m, (uint8_t[]){0xCC, 0xBE}, 2);
+    ow_master_read(m, 9);
+    sim_run_until(m->t);
+    memcpy(sp, m->rx, 9);
+    return crc8(sp, 8) == sp[8];
+}
+
+// a read scratchpad that a conversion ends in must send the scratch pad as it was when the read
+// started, not some bytes from before the conversion and the rest from after. Times a conversion
+// by polling for its end, then converts at another temperature and reads across that end
+static int conv_read_check(ow_master_t *m, sim_chip_t *chip, bool verbose) {
+    sim_chip_attr_set(chip, "temperature", "10");
+    ow_master_reset(m);
+    ow_master_write(m, (uint8_t[]){0xCC, 0x44}, 2);
+    uint64_t start = m->t;
+    uint64_t conv_ns = 0;
+    for (int i = 0; i < 30000 && conv_ns == 0; i++) {
+        ow_master_rx_clear(m);
+        ow_master_read_bit(m);
+        sim_run_until(m->t);
+        if (m->rx[0] & 1) conv_ns = m->t - m->timing.slot - start;
+    }
+
+    // reset, skip, read scratchpad and 4 of its bytes before the conversion ends
+    const ow_master_timing_t *tm = &m->timing;
+    uint64_t lead = tm->reset_low + tm->reset_high + (uint64_t)(16 + 4 * 8) * tm->slot;
+    uint8_t before[9], during[9], after[9];
+    if (!read_scratchpad(m, before) || conv_ns <= lead) {
+        fprintf(stderr, "conversion read check: %s\n", conv_ns <= lead ? "conversion too short to read across" : "bad crc");
+        return 1;
+    }
+
+    sim_chip_attr_set(chip, "temperature", "42.5");
+    ow_master_reset(m);
+    ow_master_write(m, (uint8_t[]){0xCC, 0x44}, 2);
+    ow_master_delay(m, conv_ns - lead);
+    bool ok = read_scratchpad(m, during) && !memcmp(during, before, 9);
+    ow_master_delay(m, conv_ns);
+    ok &= read_scratchpad(m, after);
+    if (verbose || !ok) {
+        print_hex("before conversion", before, 9);
+        print_hex("across its end", during, 9);
+        print_hex("after", after, 9);
+    }
+    if (!ok) {
+        fprintf(stderr, "conversion read check: the scratch pad changed while it was read\n");
+    }
+    return !ok;
+}
+
+int main(int argc, char **argv) {
+    const char *diagram = "diagram.json";
+    const char *type = "chip-ds18b20";
+    const char *overrides[MAX_OVERRIDES];
+    int num_overrides = 0;
+    long transactions = 100;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) {
+            verbose = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "-H")) {
+            sim_timer_heap(true);
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-d")) diagram = argv[++i];
+        else if (!strcmp(argv[i], "-t")) type = argv[++i];
+        else if (!strcmp(argv[i], "-n")) transactions = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-k")) return kernel_bench(strtoull(argv[++i], NULL, 0));
+        else if (!strcmp(argv[i], "-T")) return timer_bench(strtoull(argv[++i], NULL, 0));
+        else if (!strcmp(argv[i], "-a") && num_overrides < MAX_OVERRIDES) overrides[num_overrides++] = argv[++i];
+        else usage();
+    }
+
+    sim_chip_t *chips[MAX_CHIPS];
+    int n = sim_load_diagram(diagram, type, chips, MAX_CHIPS);
+    if (n <= 0) {
+        fprintf(stderr, "no %s parts in %s\n", type, diagram);
+        return 1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < num_overrides; j++) {
+            if (sim_chip_attr_arg(chips[i], overrides[j]) < 0) usage();
+        }
+        sim_chip_call(chips[i], chip_init);
+    }
+
+    // the bus pull-up resistor
+    sim_net_t dq = sim_chip_net(chips[0], "DQ");
+    if (dq == SIM_NO_NET) {
+        fprintf(stderr, "%s:DQ is not connected\n", sim_chip_id(chips[0]));
+        return 1;
+    }
+    sim_net_pullup(dq, true);
+
+    ow_master_t m;
+    ow_master_init(&m, dq);
+    int errors = 0;
+    double t0 = sim_wall_s();
+
+    // read the ROM, convert, read the scratch pad. Talks to a single chip, with more on the bus the
+    // ROM read collides
+    for (long i = 0; i < transactions; i++) {
+        ow_master_rx_clear(&m);
+        ow_master_reset(&m);
+        ow_master_write(&m, (uint8_t[]){0x33}, 1);
+        ow_master_read(&m, 8);
+        sim_run_until(m.t);
+        errors += check_crc("read rom", m.rx, 8);
+        if (verbose) print_hex("rom", m.rx, 8);
+
+        ow_master_reset(&m);
+        ow_master_write(&m, (uint8_t[]){0xCC, 0x44}, 2);
+        ow_master_delay(&m, CONV_WAIT_NS);
+
+        ow_master_rx_clear(&m);
+        ow_master_reset(&m);
+        ow_master_write(&m, (uint8_t[]){0xCC, 0xBE}, 2);
+        ow_master_read(&m, 9);
+        sim_run_until(m.t);
+        errors += check_crc("read scratchpad", m.rx, 9);
+        if (verbose) print_hex("scratchpad", m.rx, 9);
+    }
+    double dt = sim_wall_s() - t0;
+    if (n == 1) {
+        errors += conv_read_check(&m, chips[0], verbose);
+    }
+
+    printf("%ld transactions, %u/%u presence pulses, %d errors, sim time %.3f s\n", transactions,
+           m.presences, m.resets, errors, sim_now() / 1e9);
+    printf("%llu events in %.3f s, %.2f M events/s, %.0f transactions/s\n", (unsigned long long)sim_events(), dt,
+           sim_events() / dt / 1e6, transactions / dt);
+    return errors || m.presences != m.resets;
+}
@@ -0,0 +1,381 @@
+// 1-Wire master load generator for the host build - drives N chips on one bus with a mix of
+// transactions at a given rate, with the master's slot timing drawn from distributions, and
+// reports the transactions per second achieved and the error rate the master sees.
+//
+//   ow_load [-d devices] [-n transactions] [-m mix] [-r rate] [-e] [-p depth] [-w conversion wait ms]
+//           [-t timing=dist]... [-s seed] [-a name=value]... [-f script] [-v]
+//
+//   -m  weights of the transaction types, e.g. search:1,match:4,convert:1. search is one search ROM
+//       pass, match a match ROM + read scratchpad of a random device, convert a skip ROM + convert T
+//       and the conversion wait. Default match:1
+//   -r  transactions per simulated second, arrivals that find the bus busy queue. 0, the default,
+//       runs them back to back
+//   -e  exponential times between arrivals (a Poisson process) instead of fixed ones
+//   -p  match and convert transactions queued on the kernel at once before their results are
+//       checked, up to 7. Search passes always run alone, each bit depends on the ones before
+//   -t  master timing (reset_low, presence_sample, reset_high, slot, write_1_low, write_0_low,
+//       read_low, read_sample) drawn for every slot: `v` fixed, `lo:hi` uniform, `mean~sd` normal,
+//       all in us
+//   -f  reads options from a file, whitespace separated, # starts a comment
+//
+// A transaction fails when its reset gets no presence pulse, a CRC doesn't match or a search finds
+// a ROM that is none of the devices.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "ow_master.h"
+#include "ow_crc.h"
+
+#define MAX_OVERRIDES   16
+#define MAX_TIMINGS     8
+#define MAX_DEPTH       (OW_MASTER_RX_LEN / 9)
+#define MAX_ARGS        256
+
+typedef enum {
+    TX_SEARCH,
+    TX_MATCH,
+    TX_CONVERT,
+    TX_TYPES
+} tx_type_t;
+
+static const char *const tx_names[TX_TYPES] = {"search", "match", "convert"};
+
+typedef enum {
+    DIST_FIXED,
+    DIST_UNIFORM,
+    DIST_NORMAL,
+} dist_type_t;
+
+typedef struct {
+    uint32_t *field;            // in the master's timing
+    const char *name;
+    dist_type_t type;
+    double a, b;                // value, lo/hi or mean/sd, ns
+} dist_t;
+
+static struct {
+    long devices;
+    long transactions;
+    uint32_t weights[TX_TYPES];
+    double rate;
+    bool poisson;
+    int depth;
+    uint64_t conv_wait_ns;
+    uint64_t seed;
+    const char *overrides[MAX_OVERRIDES];
+    int num_overrides;
+    const char *timing_args[MAX_TIMINGS];
+    int num_timings;
+    bool verbose;
+} cfg = {
+    .devices = 1, .transactions = 1000, .weights = {0, 1, 0}, .depth = 1, .conv_wait_ns = 750000000ull, .seed = 1,
+};
+
+typedef struct {
+    long count[TX_TYPES];
+    long errors[TX_TYPES];
+    long presence_misses;
+} load_stats_t;
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_load [-d devices] [-n transactions] [-m mix] [-r rate] [-e] [-p depth] [-w conversion wait ms]\n"
+                    "               [-t timing=dist]... [-s seed] [-a name=value]... [-f script] [-v]\n");
+    exit(2);
+}
+
+// ==================== random numbers =========================
+
+static uint64_t rng;
+
+static uint64_t rand_u64(void) {
+    // xorshift64*
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545F4914F6CDD1Dull;
+}
+
+// uniform in [0, 1)
+static double rand_unit(void) {
+    return (rand_u64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double rand_normal(double mean, double sd) {
+    double u = rand_unit(), v = rand_unit();
+    return mean + sd * sqrt(-2 * log(1 - u)) * cos(2 * M_PI * v);
+}
+
+// ==================== options =========================
+
+static void parse_mix(const char *s) {
+    memset(cfg.weights, 0, sizeof(cfg.weights));
+    while (*s) {
+        int t = 0;
+        while (t < TX_TYPES && strncmp(s, tx_names[t], strlen(tx_names[t]))) t++;
+        if (t == TX_TYPES) usage();
+        s += strlen(tx_names[t]);
+        cfg.weights[t] = 1;
+        if (*s == ':') cfg.weights[t] = strtoul(s + 1, (char **)&s, 10);
+        if (*s == ',') s++;
+        else if (*s) usage();
+    }
+}
+
+static void parse_dist(const char *arg, ow_master_t *m, dist_t *d) {
+    char name[32];
+    const char *eq = strchr(arg, '=');
+    if (eq == NULL || eq - arg >= (long)sizeof(name)) usage();
+    snprintf(name, sizeof(name), "%.*s", (int)(eq - arg), arg);
+    d->field = ow_master_timing_field(&m->timing, name);
+    if (d->field == NULL) {
+        fprintf(stderr, "unknown master timing %s\n", name);
+        exit(2);
+    }
+    d->name = arg;
+
+    char *end;
+    d->a = strtod(eq + 1, &end) * 1000;
+    if (end == eq + 1) usage();
+    d->type = DIST_FIXED;
+    if (*end == ':' || *end == '~') {
+        d->type = *end == ':' ? DIST_UNIFORM : DIST_NORMAL;
+        const char *b = end + 1;
+        d->b = strtod(b, &end) * 1000;
+        if (end == b) usage();
+    }
+    if (*end) usage();
+}
+
+static void parse_args(int argc, char **argv);
+
+// options from a file, as if they were given on the command line
+static void parse_script(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        exit(2);
+    }
+    char **args = calloc(MAX_ARGS, sizeof(char *));
+    int n = 1;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+            if (n == MAX_ARGS) usage();
+            args[n++] = strdup(tok);
+        }
+    }
+    fclose(f);
+    parse_args(n, args);
+}
+
+static void parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) {
+            cfg.verbose = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "-e")) {
+            cfg.poisson = true;
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-d")) cfg.devices = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-n")) cfg.transactions = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-m")) parse_mix(argv[++i]);
+        else if (!strcmp(argv[i], "-r")) cfg.rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-p")) cfg.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-w")) cfg.conv_wait_ns = (uint64_t)(atof(argv[++i]) * 1e6);
+        else if (!strcmp(argv[i], "-s")) cfg.seed = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-f")) parse_script(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && cfg.num_timings < MAX_TIMINGS) cfg.timing_args[cfg.num_timings++] = argv[++i];
+        else if (!strcmp(argv[i], "-a") && cfg.num_overrides < MAX_OVERRIDES) cfg.overrides[cfg.num_overrides++] = argv[++i];
+        else usage();
+    }
+}
+
+// ==================== load =========================
+
+static dist_t dists[MAX_TIMINGS];
+static int num_dists;
+
+static void draw_timing(ow_master_t *m, void *user) {
+    for (int i = 0; i < num_dists; i++) {
+        const dist_t *d = &dists[i];
+        double v = d->a;
+        if (d->type == DIST_UNIFORM) v = d->a + (d->b - d->a) * rand_unit();
+        else if (d->type == DIST_NORMAL) v = rand_normal(d->a, d->b);
+        *d->field = v > 0 ? (uint32_t)llround(v) : 0;
+    }
+}
+
+static tx_type_t pick_type(void) {
+    uint32_t total = 0;
+    for (int t = 0; t < TX_TYPES; t++) total += cfg.weights[t];
+    uint32_t r = rand_u64() % total;
+    int t = 0;
+    while (r >= cfg.weights[t]) r -= cfg.weights[t++];
+    return t;
+}
+
+static void device_rom(uint64_t id, uint8_t rom[8]) {
+    uint8_t family = 0x10;
+    for (int i = 0; i < cfg.num_overrides; i++) {
+        if (!strncmp(cfg.overrides[i], "familyCode=", 11)) family = strtoul(cfg.overrides[i] + 11, NULL, 0);
+    }
+    ow_master_rom(rom, family, id);
+}
+
+static bool known_rom(const uint8_t rom[8]) {
+    return crc8(rom, 7) == rom[7] && ow_master_dev_num(ow_master_rom_id(rom)) < (uint64_t)cfg.devices;
+}
+
+// the transactions queued on the kernel and not checked yet
+typedef struct {
+    tx_type_t type[MAX_DEPTH];
+    int n;
+    uint32_t rx_bits[MAX_DEPTH];    // where each one's reply starts in the master's rx
+    uint32_t bits;                  // read by the batch
+} batch_t;
+
+static void batch_check(ow_master_t *m, batch_t *b, load_stats_t *s) {
+    sim_run_until(m->t);
+    for (int i = 0; i < b->n; i++) {
+        bool presence = m->presence_log >> (b->n - 1 - i) & 1;
+        bool ok = presence;
+        if (b->type[i] == TX_MATCH) {
+            const uint8_t *rx = m->rx + b->rx_bits[i] / 8;
+            ok &= crc8(rx, 8) == rx[8];
+        }
+        s->presence_misses += !presence;
+        s->errors[b->type[i]] += !ok;
+    }
+    ow_master_rx_clear(m);
+    b->n = 0;
+    b->bits = 0;
+}
+
+static int run(FILE *out) {
+    sim_net_t dq = sim_net_new("DQ");
+    sim_net_t vcc = sim_net_new("VCC");
+    sim_net_force(vcc, HIGH);
+    uint8_t (*roms)[8] = malloc(cfg.devices * 8);
+    for (long i = 0; i < cfg.devices; i++) {
+        char name[32], id[16];
+        snprintf(name, sizeof(name), "ds%ld", i);
+        sim_chip_t *chip = sim_chip_new(name);
+        uint64_t dev_id = ow_master_dev_id(i);
+        snprintf(id, sizeof(id), "%012llx", (unsigned long long)dev_id);
+        sim_chip_attr(chip, "deviceID", id);
+        sim_chip_attr(chip, "genDebug", "0");
+        for (int j = 0; j < cfg.num_overrides; j++) {
+            if (sim_chip_attr_arg(chip, cfg.overrides[j]) < 0) usage();
+        }
+        sim_chip_bind(chip, "DQ", dq);
+        sim_chip_bind(chip, "VCC", vcc);
+        sim_chip_call(chip, chip_init);
+        device_rom(dev_id, roms[i]);
+    }
+
+    sim_net_pullup(dq, true);
+    ow_master_t m;
+    ow_master_init(&m, dq);
+    for (int i = 0; i < cfg.num_timings; i++) {
+        parse_dist(cfg.timing_args[i], &m, &dists[num_dists++]);
+    }
+    if (num_dists > 0) {
+        m.on_slot = draw_timing;
+    }
+
+    load_stats_t s = {0};
+    batch_t b = {0};
+    uint64_t arrival = sim_now();
+    uint64_t sim_t0 = sim_now(), ev0 = sim_events();
+    double t0 = sim_wall_s();
+
+    for (long k = 0; k < cfg.transactions; k++) {
+        if (cfg.rate > 0) {
+            double gap = cfg.poisson ? -log(1 - rand_unit()) / cfg.rate : 1 / cfg.rate;
+            arrival += (uint64_t)(gap * 1e9);
+            if (m.t < arrival) m.t = arrival;
+        }
+
+        tx_type_t type = pick_type();
+        s.count[type]++;
+        if (type == TX_SEARCH) {
+            batch_check(&m, &b, &s);
+            uint8_t rom[8];
+            uint32_t presences = m.presences;
+            int r = ow_master_search(&m, rom);
+            ow_master_rx_clear(&m);
+            s.presence_misses += m.presences == presences;
+            s.errors[type] += r != 1 || !known_rom(rom);
+            continue;
+        }
+
+        b.type[b.n] = type;
+        b.rx_bits[b.n] = b.bits;
+        b.n++;
+        ow_master_reset(&m);
+        if (type == TX_MATCH) {
+            uint8_t cmd[10] = {0x55};
+            memcpy(cmd + 1, roms[rand_u64() % cfg.devices], 8);
+            cmd[9] = 0xBE;
+            ow_master_write(&m, cmd, 10);
+            ow_master_read(&m, 9);
+            b.bits += 9 * 8;
+        } else {
+            ow_master_write(&m, (const uint8_t[]){0xCC, 0x44}, 2);
+            ow_master_delay(&m, cfg.conv_wait_ns);
+        }
+        if (b.n == cfg.depth) {
+            batch_check(&m, &b, &s);
+        }
+    }
+    batch_check(&m, &b, &s);
+    double dt = sim_wall_s() - t0;
+    double sim_s = (sim_now() - sim_t0) / 1e9;
+
+    long errors = 0;
+    fprintf(out, "type         count   errors  error rate\n");
+    for (int t = 0; t < TX_TYPES; t++) {
+        if (s.count[t] == 0) continue;
+        fprintf(out, "%-8s %9ld %8ld %11.5f\n", tx_names[t], s.count[t], s.errors[t], (double)s.errors[t] / s.count[t]);
+        errors += s.errors[t];
+    }
+    fprintf(out, "%ld transactions on %ld devices, %ld errors (%.5f), %ld missed presence pulses\n", cfg.transactions,
+            cfg.devices, errors, (double)errors / cfg.transactions, s.presence_misses);
+    fprintf(out, "sim %.3f s, %.1f transactions/s; wall %.3f s, %.1f transactions/s, %llu events\n", sim_s,
+            sim_s > 0 ? cfg.transactions / sim_s : 0, dt, cfg.transactions / dt,
+            (unsigned long long)(sim_events() - ev0));
+    free(roms);
+    return errors != 0;
+}
+
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+
+    uint32_t total = 0;
+    for (int t = 0; t < TX_TYPES; t++) total += cfg.weights[t];
+    if (cfg.devices <= 0 || cfg.transactions <= 0 || cfg.rate < 0 || total == 0 || cfg.depth < 1 || cfg.depth > MAX_DEPTH) {
+        usage();
+    }
+    rng = cfg.seed ? cfg.seed : 1;
+
+    // the chips log to stdout, the report goes to the original one
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!cfg.verbose) freopen("/dev/null", "w", stdout);
+    int ret = run(out);
+    fclose(out);
+    return ret;
+}
@@ -0,0 +1,191 @@
+// 1-Wire bus master for the host build - slot timing on top of the event kernel
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stddef.h>
+#include <string.h>
+
+#include "ow_master.h"
+#include "ow_crc.h"
+
+#define US(v)   ((v) * 1000)
+
+typedef enum {
+    OP_LOW,
+    OP_RELEASE,
+    OP_SAMPLE_PRESENCE,
+    OP_SAMPLE_BIT,
+} op_t;
+
+static void on_op(void *arg, uint32_t op) {
+    ow_master_t *m = arg;
+
+    switch (op) {
+        case OP_LOW:
+            pin_mode(m->pin, OUTPUT_LOW);
+            break;
+        case OP_RELEASE:
+            pin_mode(m->pin, INPUT);
+            break;
+        case OP_SAMPLE_PRESENCE:
+            m->resets++;
+            m->presences += pin_read(m->pin) == LOW;
+            m->presence_log = m->presence_log << 1 | (pin_read(m->pin) == LOW);
+            break;
+        case OP_SAMPLE_BIT:
+            if (m->rx_bits < OW_MASTER_RX_LEN * 8) {
+                if (pin_read(m->pin)) m->rx[m->rx_bits / 8] |= 1 << (m->rx_bits % 8);
+                m->rx_bits++;
+            }
+            break;
+    }
+}
+
+// start of the next operation, never in the past
+static uint64_t cursor(ow_master_t *m) {
+    if (m->on_slot != NULL) {
+        m->on_slot(m, m->on_slot_user);
+    }
+    return m->t > sim_now() ? m->t : sim_now();
+}
+
+#define TIMING_FIELD(f)     {#f, offsetof(ow_master_timing_t, f)}
+static const struct {
+    const char *name;
+    size_t offset;
+} timing_fields[] = {
+    TIMING_FIELD(reset_low), TIMING_FIELD(presence_sample), TIMING_FIELD(reset_high), TIMING_FIELD(slot),
+    TIMING_FIELD(write_1_low), TIMING_FIELD(write_0_low), TIMING_FIELD(read_low), TIMING_FIELD(read_sample),
+};
+
+uint32_t *ow_master_timing_field(ow_master_timing_t *t, const char *name) {
+    for (size_t i = 0; i < sizeof(timing_fields) / sizeof(timing_fields[0]); i++) {
+        if (!strcmp(timing_fields[i].name, name)) return (uint32_t *)((uint8_t *)t + timing_fields[i].offset);
+    }
+    return NULL;
+}
+
+void ow_master_init(ow_master_t *m, sim_net_t net) {
+    memset(m, 0, sizeof(ow_master_t));
+    m->pin = sim_pin_new(net, "master", INPUT);
+    m->timing = (ow_master_timing_t){
+        .reset_low = US(OWM_RESET_LOW),
+        .presence_sample = US(OWM_PRESENCE_SAMPLE),
+        .reset_high = US(OWM_RESET_HIGH),
+        .slot = US(OWM_SLOT),
+        .write_1_low = US(OWM_WRITE_1_LOW),
+        .write_0_low = US(OWM_WRITE_0_LOW),
+        .read_low = US(OWM_READ_LOW),
+        .read_sample = US(OWM_READ_SAMPLE),
+    };
+}
+
+void ow_master_reset(ow_master_t *m) {
+    const ow_master_timing_t *tm = &m->timing;
+    uint64_t t = cursor(m);
+    sim_at(t, on_op, m, OP_LOW);
+    sim_at(t + tm->reset_low, on_op, m, OP_RELEASE);
+    sim_at(t + tm->reset_low + tm->presence_sample, on_op, m, OP_SAMPLE_PRESENCE);
+    m->t = t + tm->reset_low + tm->reset_high;
+}
+
+void ow_master_write_bit(ow_master_t *m, uint8_t bit) {
+    uint64_t t = cursor(m);
+    sim_at(t, on_op, m, OP_LOW);
+    sim_at(t + (bit ? m->timing.write_1_low : m->timing.write_0_low), on_op, m, OP_RELEASE);
+    m->t = t + m->timing.slot;
+}
+
+void ow_master_write(ow_master_t *m, const uint8_t *buf, uint32_t len) {
+    for (uint32_t i = 0; i < len * 8; i++) {
+        ow_master_write_bit(m, buf[i / 8] >> (i % 8) & 1);
+    }
+}
+
+void ow_master_read_bit(ow_master_t *m) {
+    uint64_t t = cursor(m);
+    sim_at(t, on_op, m, OP_LOW);
+    sim_at(t + m->timing.read_low, on_op, m, OP_RELEASE);
+    sim_at(t + m->timing.read_sample, on_op, m, OP_SAMPLE_BIT);
+    m->t = t + m->timing.slot;
+}
+
+void ow_master_read(ow_master_t *m, uint32_t len) {
+    for (uint32_t i = 0; i < len * 8; i++) {
+        ow_master_read_bit(m);
+    }
+}
+
+void ow_master_delay(ow_master_t *m, uint64_t ns) {
+    uint64_t t = m->t > sim_now() ? m->t : sim_now();
+    m->t = t + ns;
+}
+
+void ow_master_rx_clear(ow_master_t *m) {
+    memset(m->rx, 0, sizeof(m->rx));
+    m->rx_bits = 0;
+}
+
+static uint8_t rx_bit(const ow_master_t *m, uint32_t i) {
+    return m->rx[i / 8] >> (i % 8) & 1;
+}
+
+int ow_master_search(ow_master_t *m, uint8_t rom[8]) {
+    if (m->search_done) {
+        m->search_done = false;
+        m->search_last = 0;
+        memset(m->search_rom, 0, sizeof(m->search_rom));
+    }
+
+    uint32_t presences = m->presences;
+    ow_master_reset(m);
+    ow_master_write(m, (const uint8_t[]){0xF0}, 1);
+    sim_run_until(m->t);
+    if (m->presences == presences) {
+        return 0;
+    }
+
+    uint8_t last_zero = 0;
+    for (uint8_t bit = 1; bit <= 64; bit++) {
+        ow_master_rx_clear(m);
+        ow_master_read_bit(m);
+        ow_master_read_bit(m);
+        sim_run_until(m->t);
+        uint8_t id = rx_bit(m, 0), cmp = rx_bit(m, 1);
+        if (id && cmp) {
+            return -1;
+        }
+
+        uint8_t *b = &m->search_rom[(bit - 1) / 8];
+        uint8_t mask = 1 << ((bit - 1) % 8);
+        uint8_t dir;
+        if (id != cmp) {
+            dir = id;
+        } else {
+            // both values present, take the other branch than last time at the last discrepancy
+            dir = bit < m->search_last ? (*b & mask) != 0 : bit == m->search_last;
+            if (!dir) last_zero = bit;
+        }
+        *b = dir ? *b | mask : *b & ~mask;
+        ow_master_write_bit(m, dir);
+    }
+    sim_run_until(m->t);
+
+    m->search_last = last_zero;
+    m->search_done = last_zero == 0;
+    memcpy(rom, m->search_rom, 8);
+    return 1;
+}
+
+void ow_master_rom(uint8_t rom[8], uint8_t family, uint64_t id) {
+    rom[0] = family;
+    for (int i = 1; i <= 6; i++) rom[i] = id >> (6 - i) * 8;
+    rom[7] = crc8(rom, 7);
+}
+
+uint64_t ow_master_rom_id(const uint8_t rom[8]) {
+    uint64_t id = 0;
+    for (int i = 1; i <= 6; i++) id = id << 8 | rom[i];
+    return id;
+}
@@ -0,0 +1,97 @@
+//
+// 1-Wire bus master for the host build. Operations are scheduled on the kernel back to back from
+// the end of the previously scheduled one, so a whole transaction can be queued up and then run.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_MASTER_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_MASTER_H
+
+#include <stdint.h>
+#include "sim.h"
+
+#define OW_MASTER_RX_LEN    64
+
+// standard speed timing, us, the defaults of ow_master_timing_t
+#define OWM_RESET_LOW       480
+#define OWM_PRESENCE_SAMPLE 70
+#define OWM_RESET_HIGH      480     // release to next slot, presence sample included
+#define OWM_SLOT            70      // whole slot, recovery included
+#define OWM_WRITE_1_LOW     6
+#define OWM_WRITE_0_LOW     60
+#define OWM_READ_LOW        6
+#define OWM_READ_SAMPLE     15      // from the start of the slot
+
+// device ids of the multi drop harnesses, device n (0 based) gets (n + 1) * OWM_ID_MULT modulo
+// 2^48. The multiplier is odd, so the ids are unique and map back to n
+#define OWM_ID_MULT         0x5DEECE66Dull
+#define OWM_ID_MASK         0xFFFFFFFFFFFFull
+
+// slot timing, ns
+typedef struct {
+    uint32_t reset_low;
+    uint32_t presence_sample;       // from the release
+    uint32_t reset_high;
+    uint32_t slot;
+    uint32_t write_1_low;
+    uint32_t write_0_low;
+    uint32_t read_low;
+    uint32_t read_sample;
+} ow_master_timing_t;
+
+typedef struct ow_master {
+    pin_t pin;
+    ow_master_timing_t timing;      // standard speed after ow_master_init, may be changed any time
+    uint64_t t;                     // end of the last scheduled operation
+    uint8_t rx[OW_MASTER_RX_LEN];   // bits read, LSB first
+    uint32_t rx_bits;
+    uint32_t resets;
+    uint32_t presences;             // reset pulses answered with a presence pulse
+    uint32_t presence_log;          // the last 32 presence samples, newest in bit 0, 1 when answered
+
+    // called before every reset pulse and slot is scheduled, e.g. to draw the timing from a
+    // distribution. NULL for none
+    void (*on_slot)(struct ow_master *m, void *user);
+    void *on_slot_user;
+
+    // search ROM state, carried from one pass to the next
+    uint8_t search_rom[8];
+    uint8_t search_last;            // bit of the last discrepancy a 0 was taken at, 1 based
+    bool search_done;               // the last pass found the last device
+} ow_master_t;
+
+void ow_master_init(ow_master_t *m, sim_net_t net);
+// the timing field of the given name (reset_low, slot, read_sample, ...), NULL if there's none
+uint32_t *ow_master_timing_field(ow_master_timing_t *t, const char *name);
+void ow_master_reset(ow_master_t *m);
+void ow_master_write_bit(ow_master_t *m, uint8_t bit);
+void ow_master_write(ow_master_t *m, const uint8_t *buf, uint32_t len);
+void ow_master_read_bit(ow_master_t *m);
+void ow_master_read(ow_master_t *m, uint32_t len);
+void ow_master_delay(ow_master_t *m, uint64_t ns);
+void ow_master_rx_clear(ow_master_t *m);
+// one search ROM pass from the end of the scheduled operations, finding the next device in ROM
+// order and starting over after the last one. Runs the kernel, each bit depends on the two read
+// before it. Returns 1 with the ROM in rom, 0 if no device answered, -1 on a bus error
+int ow_master_search(ow_master_t *m, uint8_t rom[8]);
+
+static inline uint64_t ow_master_dev_id(uint64_t n) {
+    return (n + 1) * OWM_ID_MULT & OWM_ID_MASK;
+}
+
+// the n an id was made from, a large number for an id that isn't one of them
+static inline uint64_t ow_master_dev_num(uint64_t id) {
+    // inverse of the multiplier modulo 2^64, each step doubles the bits that are right
+    uint64_t inv = OWM_ID_MULT;
+    for (int i = 0; i < 5; i++) inv *= 2 - OWM_ID_MULT * inv;
+    return (id * inv & OWM_ID_MASK) - 1;
+}
+
+// the ROM of a chip with the given family code and deviceID, serial LSB first as it's sent
+void ow_master_rom(uint8_t rom[8], uint8_t family, uint64_t id);
+// the deviceID in a ROM
+uint64_t ow_master_rom_id(const uint8_t rom[8]);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_MASTER_H
@@ -0,0 +1,470 @@
+// Callback log replay for the host build - re-drives the chip from a log written by the recorder of
+// include/ow_rec.h (`recordLog`), without the simulator. The Wokwi imports are implemented here:
+// reads return the logged values and the pin and timer callbacks are made at their logged times.
+// Reports the callback throughput, so changes to the chip can be measured on a real session.
+//
+//   ow_recplay [-o log.owrec] [-q] [-v] console.log|log.owrec
+//
+// The log is read from the `~R` lines of a console log, or from a binary log written with -o. The
+// replay is checked as it goes and stops at the first divergence:
+//
+//   - the chip must ask for the logged inputs in the logged order
+//   - its pin writes and mode changes must match the logged ones
+//   - a logged callback must be for a watched pin or a running timer
+//
+// A timer firing at another time than the one it was started for is counted but not fatal, the
+// simulator may round timer periods.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include "wokwi-api.h"
+#include "sim.h"
+#include "ow_rec.h"
+
+// this file provides the imports the recorder wraps
+#undef pin_init
+#undef pin_watch
+#undef timer_init
+#undef pin_read
+#undef pin_adc_read
+#undef attr_read
+#undef attr_read_float
+#undef string_read
+#undef pin_mode
+#undef pin_write
+
+#define OWREC_MAGIC         "OWREC\0\0\1"
+#define MAX_ATTRS           64
+#define NAME_LEN            32
+
+typedef struct {
+    uint8_t type;
+    uint64_t delta;
+    uint32_t value;
+    const uint8_t *str;         // REC_STRING bytes
+    uint32_t str_len;
+} rec_t;
+
+typedef struct {
+    pin_watch_config_t watch;
+    bool watching;
+} pin_rec_t;
+
+typedef struct {
+    timer_config_t cfg;
+    bool armed;
+    bool repeat;
+    uint64_t period;
+    uint64_t due;
+} timer_rec_t;
+
+static struct {
+    const uint8_t *p, *end;
+    uint64_t records;
+    uint64_t now;
+    bool verbose;
+    jmp_buf stop;
+
+    pin_rec_t pins[OW_REC_PINS];
+    uint32_t num_pins;
+    timer_rec_t timers[OW_REC_TIMERS];
+    uint32_t num_timers;
+    char attrs[MAX_ATTRS][NAME_LEN];
+    uint32_t num_attrs;
+
+    uint64_t pin_callbacks, timer_callbacks, reads, outputs, late_timers;
+} rp;
+
+enum { STOP_DIVERGED = 1, STOP_TRUNCATED };
+
+static const char *type_names[] = {"start", "pin", "timer", "attr", "read", "adc", "string", "out"};
+
+static const char *type_name(uint8_t type) {
+    return (type & ~REC_NESTED) <= REC_OUT ? type_names[type & ~REC_NESTED] : "unknown";
+}
+
+// ==================== log =========================
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// the bytes of the ~R lines in sequence, the first recording only
+static uint8_t *load_console(FILE *f, size_t *len) {
+    size_t cap = 1 << 16;
+    uint8_t *buf = malloc(cap);
+    char *line = NULL;
+    size_t line_cap = 0;
+    long expect = 0;
+
+    *len = 0;
+    while (getline(&line, &line_cap, f) > 0) {
+        const char *s = strstr(line, "~R ");
+        if (s == NULL) continue;
+        char *hex;
+        long seq = strtol(s + 3, &hex, 10);
+        if (seq == 0 && expect > 0) {
+            fprintf(stderr, "a second recording starts after line %ld, ignored\n", expect - 1);
+            break;
+        }
+        if (seq != expect) {
+            fprintf(stderr, "~R line %ld missing, the log is cut there\n", expect);
+            break;
+        }
+        expect++;
+        while (*hex == ' ') hex++;
+        for (; hex_digit(hex[0]) >= 0 && hex_digit(hex[1]) >= 0; hex += 2) {
+            if (*len == cap) buf = realloc(buf, cap *= 2);
+            buf[(*len)++] = hex_digit(hex[0]) << 4 | hex_digit(hex[1]);
+        }
+    }
+    free(line);
+    return buf;
+}
+
+static uint8_t *load(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    char magic[8];
+    if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, OWREC_MAGIC, sizeof(magic))) {
+        rewind(f);
+        uint8_t *buf = load_console(f, len);
+        fclose(f);
+        return buf;
+    }
+
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f) - sizeof(magic);
+    fseek(f, sizeof(magic), SEEK_SET);
+    uint8_t *buf = malloc(*len ? *len : 1);
+    if (fread(buf, 1, *len, f) != *len) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    return buf;
+}
+
+static int save(const char *path, const uint8_t *buf, size_t len) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fwrite(OWREC_MAGIC, 1, 8, f);
+    fwrite(buf, 1, len, f);
+    return fclose(f) ? -1 : 0;
+}
+
+static bool timed(uint8_t type) {
+    return type == REC_START || type == REC_PIN || type == REC_TIMER;
+}
+
+static bool is_callback(uint8_t type) {
+    uint8_t t = type & ~REC_NESTED;
+    return t == REC_PIN || t == REC_TIMER;
+}
+
+static uint64_t get_varint(void) {
+    uint64_t v = 0;
+    for (int shift = 0; rp.p < rp.end; shift += 7) {
+        uint8_t b = *rp.p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    longjmp(rp.stop, STOP_TRUNCATED);
+}
+
+static bool peek_type(uint8_t *type) {
+    if (rp.p >= rp.end) return false;
+    *type = *rp.p;
+    return true;
+}
+
+static rec_t next(void) {
+    rec_t r = {0};
+    if (rp.p >= rp.end) {
+        longjmp(rp.stop, STOP_TRUNCATED);
+    }
+    r.type = *rp.p++;
+    if (timed(r.type)) r.delta = get_varint();
+    r.value = get_varint();
+    if (r.type == REC_STRING) {
+        r.str_len = get_varint();
+        if (rp.end - rp.p < r.str_len) longjmp(rp.stop, STOP_TRUNCATED);
+        r.str = rp.p;
+        rp.p += r.str_len;
+    }
+    rp.records++;
+    return r;
+}
+
+static void diverge(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void diverge(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "diverged at record %llu, %.3f ms: ", (unsigned long long)rp.records, rp.now / 1e6);
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    longjmp(rp.stop, STOP_DIVERGED);
+}
+
+static rec_t take(uint8_t type) {
+    rec_t r = next();
+    if (r.type != type) {
+        diverge("the chip reads %s, the log has %s", type_name(type), type_name(r.type));
+    }
+    rp.reads++;
+    return r;
+}
+
+static void dispatch(rec_t r) {
+    uint32_t idx = (r.type & ~REC_NESTED) == REC_PIN ? r.value >> 1 : r.value;
+
+    if (rp.verbose) {
+        printf("%12.3f us %s%s %u%s\n", rp.now / 1e3, r.type & REC_NESTED ? "  nested " : "", type_name(r.type),
+               idx, (r.type & ~REC_NESTED) == REC_PIN ? (r.value & 1 ? " high" : " low") : "");
+    }
+    if ((r.type & ~REC_NESTED) == REC_PIN) {
+        if (idx >= rp.num_pins || !rp.pins[idx].watching) diverge("pin %u is not watched", idx);
+        rp.pin_callbacks++;
+        rp.pins[idx].watch.pin_change(rp.pins[idx].watch.user_data, idx, r.value & 1);
+        return;
+    }
+
+    timer_rec_t *t = idx < rp.num_timers ? &rp.timers[idx] : NULL;
+    if (t == NULL || !t->armed) diverge("timer %u is not running", idx);
+    if (t->due != rp.now) rp.late_timers++;
+    if (t->repeat) {
+        t->due = rp.now + t->period;
+    } else {
+        t->armed = false;
+    }
+    rp.timer_callbacks++;
+    t->cfg.callback(t->cfg.user_data);
+}
+
+// callbacks an output of the chip made in the recorded session
+static void dispatch_nested(void) {
+    uint8_t type;
+    while (peek_type(&type) && is_callback(type) && (type & REC_NESTED)) {
+        dispatch(next());
+    }
+}
+
+// ==================== Wokwi API =========================
+
+pin_t pin_init(const char *name, uint32_t mode) {
+    if (rp.num_pins == OW_REC_PINS) diverge("more than %d pins", OW_REC_PINS);
+    return rp.num_pins++;
+}
+
+uint32_t pin_read(pin_t pin) {
+    return take(REC_READ).value;
+}
+
+static void output(pin_t pin, uint32_t write, uint32_t value) {
+    rec_t r = take(REC_OUT);
+    rp.reads--;
+    rp.outputs++;
+    if (r.value != REC_OUT_VALUE(pin, write, value)) {
+        diverge("the chip sets pin %u %s %u, the log has pin %u %s %u", pin, write ? "to" : "mode", value,
+                r.value >> 6, r.value & 0x20 ? "to" : "mode", r.value & 0x1F);
+    }
+    dispatch_nested();
+}
+
+void pin_write(pin_t pin, uint32_t value) {
+    output(pin, 1, value);
+}
+
+void pin_mode(pin_t pin, uint32_t value) {
+    output(pin, 0, value);
+}
+
+bool pin_watch(pin_t pin, const pin_watch_config_t *config) {
+    if (pin >= rp.num_pins) return false;
+    rp.pins[pin].watch = *config;
+    rp.pins[pin].watching = true;
+    return true;
+}
+
+void pin_watch_stop(pin_t pin) {
+    if (pin < rp.num_pins) rp.pins[pin].watching = false;
+}
+
+static float float_bits(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+float pin_adc_read(pin_t pin) {
+    return float_bits(take(REC_ADC).value);
+}
+
+float pin_dac_write(pin_t pin, float voltage) {
+    return voltage;
+}
+
+timer_t timer_init(const timer_config_t *config) {
+    if (rp.num_timers == OW_REC_TIMERS) diverge("more than %d timers", OW_REC_TIMERS);
+    rp.timers[rp.num_timers].cfg = *config;
+    return rp.num_timers++;
+}
+
+void timer_start_ns_d(const timer_t timer, double nanos, bool repeat) {
+    timer_rec_t *t = &rp.timers[timer];
+    t->period = nanos > 0 ? (uint64_t)nanos : 0;
+    t->repeat = repeat && t->period > 0;
+    t->due = rp.now + t->period;
+    t->armed = true;
+}
+
+void timer_start(const timer_t timer, uint32_t micros, bool repeat) {
+    timer_start_ns_d(timer, micros * 1000.0, repeat);
+}
+
+void timer_stop(const timer_t timer) {
+    rp.timers[timer].armed = false;
+}
+
+double get_sim_nanos_d(void) {
+    return (double)rp.now;
+}
+
+uint32_t attr_init(const char *name, uint32_t default_value) {
+    uint32_t id = rp.num_attrs < MAX_ATTRS ? rp.num_attrs++ : MAX_ATTRS - 1;
+    snprintf(rp.attrs[id], NAME_LEN, "%s", name);
+    return id;
+}
+
+uint32_t attr_init_float(const char *name, float default_value) {
+    return attr_init(name, 0);
+}
+
+uint32_t attr_read(uint32_t attr_id) {
+    // read by the recorder before it starts, the replay is not recorded again
+    if (!strcmp(rp.attrs[attr_id], "recordLog")) return 0;
+    return take(REC_ATTR).value;
+}
+
+float attr_read_float(uint32_t attr_id) {
+    return float_bits(take(REC_ATTR).value);
+}
+
+string_t attr_string_init(const char *name) {
+    return attr_init(name, 0) + 1;
+}
+
+uint32_t string_get_length(string_t string) {
+    diverge("string_get_length is not recorded");
+    return 0;
+}
+
+uint32_t string_read(string_t string, char *buf, uint32_t buffer_size) {
+    rec_t r = take(REC_STRING);
+    if (buffer_size > 0) {
+        uint32_t n = r.str_len < buffer_size - 1 ? r.str_len : buffer_size - 1;
+        memcpy(buf, r.str, n);
+        buf[n] = 0;
+    }
+    return r.value;
+}
+
+// telemetry goes nowhere, its write completions are not callbacks the recorder logs
+uart_dev_t uart_init(const uart_config_t *config) {
+    return 0;
+}
+
+bool uart_write(uart_dev_t uart, uint8_t *buffer, uint32_t count) {
+    return true;
+}
+
+// ==================== replay =========================
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_recplay [-o log.owrec] [-q] [-v] console.log|log.owrec\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    const char *out = NULL;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) rp.verbose = true;
+        else if (!strcmp(argv[i], "-q")) quiet = true;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) out = argv[++i];
+        else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+        else usage();
+    }
+    if (path == NULL) usage();
+
+    size_t len;
+    uint8_t *buf = load(path, &len);
+    if (buf == NULL) {
+        return 1;
+    }
+    if (len == 0) {
+        fprintf(stderr, "%s: no recording\n", path);
+        return 1;
+    }
+    if (out != NULL && save(out, buf, len) < 0) {
+        return 1;
+    }
+    // the chip log of the replay
+    if (quiet) freopen("/dev/null", "w", stdout);
+
+    rp.p = buf;
+    rp.end = buf + len;
+    double t0 = sim_wall_s();
+    int stop = setjmp(rp.stop);
+    if (stop == 0) {
+        rec_t start = next();
+        if (start.type != REC_START || start.value != OW_REC_VERSION) {
+            fprintf(stderr, "%s: not a version %d recording\n", path, OW_REC_VERSION);
+            return 1;
+        }
+        rp.now = start.delta;
+        chip_init();
+
+        uint8_t type;
+        while (peek_type(&type)) {
+            rec_t r = next();
+            if (!is_callback(r.type) || (r.type & REC_NESTED)) {
+                diverge("the chip is done, the log has %s%s", r.type & REC_NESTED ? "nested " : "", type_name(r.type));
+            }
+            rp.now += r.delta;
+            dispatch(r);
+        }
+    }
+    double dt = sim_wall_s() - t0;
+    uint64_t callbacks = rp.pin_callbacks + rp.timer_callbacks;
+
+    if (stop == STOP_TRUNCATED) fprintf(stderr, "the log ends inside a callback at %.3f ms\n", rp.now / 1e6);
+    fprintf(stderr, "%zu bytes, %llu records, %llu callbacks (%llu pin, %llu timer), %llu reads, %llu outputs checked, "
+            "%llu timers off their deadline, sim time %.3f s\n", len, (unsigned long long)rp.records,
+            (unsigned long long)callbacks, (unsigned long long)rp.pin_callbacks,
+            (unsigned long long)rp.timer_callbacks, (unsigned long long)rp.reads, (unsigned long long)rp.outputs,
+            (unsigned long long)rp.late_timers, rp.now / 1e9);
+    fprintf(stderr, "replayed in %.3f s, %.2f M callbacks/s\n", dt, callbacks / dt / 1e6);
+    free(buf);
+    return stop == STOP_DIVERGED;
+}
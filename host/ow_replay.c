@@ -0,0 +1,267 @@
+// Capture replay for the host build - streams one wire of a logic analyzer VCD or binary capture
+// (tools/vcd2cap) into the chip's DQ net and checks the chip answers the way the captured device
+// did. Reports the replay throughput.
+//
+//   ow_replay [-f capture.vcd|capture.owcap] [-w D0] [-d diagram.json] [-t chip-ds18b20] [-a name=value]...
+//             [-T tolerance us] [-r repeats] [-v]
+//
+// The captured wire carries both sides of the bus. Every low period is driven by the replay master
+// except presence pulses - the first low after a reset pulse - which are left to the chip. The
+// chip's own pull-downs are followed with a drive probe on the net and checked against the capture:
+//
+//   - a presence pulse must be pulled by the chip, starting and ending within the tolerance
+//   - a pull-down inside a low the master drives (a 0 read slot) must end within the tolerance of
+//     the captured rising edge
+//   - a pull-down while the capture is high must be followed by a captured falling edge within the
+//     tolerance
+//
+// A read slot the chip fails to stretch is not caught, the master holds the line for the captured
+// duration either way.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "vcd.h"
+#include "owcap.h"
+
+#define MAX_CHIPS           16
+#define MAX_OVERRIDES       16
+#define MAX_REPORTED        20
+
+#define US(v)               ((uint64_t)(v) * 1000)
+#define RESET_MIN           US(400)     // lows this long are reset pulses
+#define PRESENCE_WINDOW     US(75)      // a presence pulse starts this soon after the reset release
+#define PASS_GAP            US(1000)    // idle time between repeats of the capture
+
+typedef struct {
+    pin_t pin;                  // replay master
+    bool driving;
+    uint64_t tol;
+    bool verbose;
+
+    // capture
+    uint32_t cap_level;
+    uint64_t cap_fall, cap_rise;
+    bool after_reset;           // the last low was a reset pulse
+    bool presence;              // the current low is a presence pulse
+
+    // chip, everything on the net but the master
+    bool chip_low;
+    bool chip_pulled;           // the chip pulled during the current captured low
+    bool pending;               // the chip pulled while the capture was high
+    uint64_t chip_fall, chip_rise;
+
+    uint64_t edges, lows, presences, responses, mismatches;
+} replay_t;
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_replay [-f capture] [-w wire] [-d diagram.json] [-t chip type] [-a name=value]...\n"
+                    "                 [-T tolerance us] [-r repeats] [-v]\n");
+    exit(2);
+}
+
+static void mismatch(replay_t *r, const char *what) {
+    if (r->mismatches++ < MAX_REPORTED || r->verbose) {
+        printf("mismatch at %.3f ms: %s\n", sim_now() / 1e6, what);
+    }
+}
+
+static void on_drivers(void *user, uint32_t drivers) {
+    replay_t *r = user;
+    bool low = drivers > (uint32_t)r->driving;
+    if (low == r->chip_low) {
+        return;
+    }
+    r->chip_low = low;
+    uint64_t now = sim_now();
+
+    if (low) {
+        r->chip_fall = now;
+        if (r->cap_level == HIGH) {
+            r->pending = true;
+            return;
+        }
+        r->chip_pulled = true;
+        if (!r->presence) {
+            r->responses++;
+        } else if (now - r->cap_fall > r->tol) {
+            mismatch(r, "late presence pulse");
+        }
+        return;
+    }
+
+    r->chip_rise = now;
+    if (r->cap_level == LOW) {
+        // an early presence release is caught on the captured edge, in a master low it's invisible
+        return;
+    }
+    if (r->pending) {
+        r->pending = false;
+        mismatch(r, "pull-down while the capture is high");
+    } else if (now - r->cap_rise > r->tol) {
+        mismatch(r, "late release");
+    }
+}
+
+static void capture_fall(replay_t *r, uint64_t t) {
+    r->cap_level = LOW;
+    r->cap_fall = t;
+    r->chip_pulled = r->chip_low;
+    r->presence = r->after_reset && t - r->cap_rise <= PRESENCE_WINDOW;
+    r->after_reset = false;
+
+    if (r->pending) {
+        r->pending = false;
+        if (t - r->chip_fall > r->tol) mismatch(r, "early pull-down");
+    }
+    if (r->presence) {
+        r->presences++;
+        return;
+    }
+    r->lows++;
+    r->driving = true;
+    pin_mode(r->pin, OUTPUT_LOW);
+}
+
+static void capture_rise(replay_t *r, uint64_t t) {
+    r->cap_level = HIGH;
+    r->cap_rise = t;
+    r->after_reset = t - r->cap_fall >= RESET_MIN;
+
+    if (r->driving) {
+        r->driving = false;
+        pin_mode(r->pin, INPUT);
+    }
+    if (!r->presence) {
+        return;
+    }
+    if (!r->chip_pulled) {
+        mismatch(r, "missing presence pulse");
+    } else if (!r->chip_low && t - r->chip_rise > r->tol) {
+        mismatch(r, "early presence release");
+    }
+}
+
+static void replay_change(replay_t *r, uint64_t t, uint32_t value) {
+    sim_run_until(t);
+    if (value == r->cap_level) {
+        return;
+    }
+    r->edges++;
+    if (value == LOW) capture_fall(r, t);
+    else capture_rise(r, t);
+}
+
+// one pass over the capture, times shifted by offset. Sets end to the time of the last change
+static int replay_pass(replay_t *r, const char *path, const char *wire, uint64_t offset, uint64_t *end) {
+    uint64_t t;
+    *end = offset;
+
+    owcap_t cap;
+    int err = owcap_open(&cap, path);
+    if (err == 0) {
+        int bit = owcap_wire(&cap, wire);
+        if (bit < 0) {
+            fprintf(stderr, "no wire named %s in %s\n", wire, path);
+            owcap_close(&cap);
+            return -1;
+        }
+        owcap_cursor_t cur;
+        owcap_seek(&cur, &cap, 0);
+        while (owcap_next(&cur)) {
+            if (!(cur.changed >> bit & 1)) continue;
+            *end = cur.time + offset;
+            replay_change(r, *end, cur.state >> bit & 1);
+        }
+        owcap_close(&cap);
+        return 0;
+    }
+    if (err != -2) {
+        return -1;
+    }
+
+    vcd_reader_t vcd;
+    if (vcd_open(&vcd, path, wire) < 0) {
+        return -1;
+    }
+    int wire_idx, value;
+    while (vcd_next(&vcd, &t, &wire_idx, &value)) {
+        *end = t + offset;
+        replay_change(r, *end, value);
+    }
+    vcd_close(&vcd);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *capture = "captures/wokwi-logic.vcd";
+    const char *wire = "D0";
+    const char *diagram = "diagram.json";
+    const char *type = "chip-ds18b20";
+    const char *overrides[MAX_OVERRIDES];
+    int num_overrides = 0;
+    long repeats = 1;
+    replay_t r = {.tol = US(5), .cap_level = HIGH};
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) {
+            r.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-f")) capture = argv[++i];
+        else if (!strcmp(argv[i], "-w")) wire = argv[++i];
+        else if (!strcmp(argv[i], "-d")) diagram = argv[++i];
+        else if (!strcmp(argv[i], "-t")) type = argv[++i];
+        else if (!strcmp(argv[i], "-T")) r.tol = US(atof(argv[++i]));
+        else if (!strcmp(argv[i], "-r")) repeats = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-a") && num_overrides < MAX_OVERRIDES) overrides[num_overrides++] = argv[++i];
+        else usage();
+    }
+
+    sim_chip_t *chips[MAX_CHIPS];
+    int n = sim_load_diagram(diagram, type, chips, MAX_CHIPS);
+    if (n <= 0) {
+        fprintf(stderr, "no %s parts in %s\n", type, diagram);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < num_overrides; j++) {
+            if (sim_chip_attr_arg(chips[i], overrides[j]) < 0) usage();
+        }
+        sim_chip_call(chips[i], chip_init);
+    }
+
+    sim_net_t dq = sim_chip_net(chips[0], "DQ");
+    if (dq == SIM_NO_NET) {
+        fprintf(stderr, "%s:DQ is not connected\n", sim_chip_id(chips[0]));
+        return 1;
+    }
+    sim_net_pullup(dq, true);
+    r.pin = sim_pin_new(dq, "replay", INPUT);
+    r.chip_low = sim_net_drivers(dq) > 0;
+    sim_net_probe(dq, on_drivers, &r);
+
+    double t0 = sim_wall_s();
+    uint64_t end = 0;
+    for (long i = 0; i < repeats; i++) {
+        if (replay_pass(&r, capture, wire, i ? end + PASS_GAP : 0, &end) < 0) return 1;
+    }
+    // let the chip finish its last answer
+    sim_run_until(end + PASS_GAP);
+    if (r.pending) mismatch(&r, "pull-down after the end of the capture");
+    double dt = sim_wall_s() - t0;
+
+    printf("%llu edges, %llu master lows, %llu presence pulses, %llu chip pull-downs, %llu mismatches, "
+           "sim time %.3f s\n", (unsigned long long)r.edges, (unsigned long long)r.lows,
+           (unsigned long long)r.presences, (unsigned long long)r.responses, (unsigned long long)r.mismatches,
+           sim_now() / 1e9);
+    printf("%llu events in %.3f s, %.2f M edges/s\n", (unsigned long long)sim_events(), dt, r.edges / dt / 1e6);
+    return r.mismatches != 0;
+}
@@ -0,0 +1,286 @@
+// Timing sweep for the host build - runs the chip under the master for every point of a grid of
+// chip timing attributes and master slot timings and writes per point results as CSV.
+//
+//   ow_sweep [-j jobs] [-n transactions] [-o results.csv] [-a name=value]... [-v] param=values...
+//
+// A parameter is a chip attribute (presenceWait, presenceTime, sampleWait, readHold, busJitter or
+// any other) or a master timing in us: master.reset_low, master.presence_sample, master.reset_high,
+// master.slot, master.write_1_low, master.write_0_low, master.read_low, master.read_sample. Values
+// are a comma separated list of numbers and lo:hi:step ranges, e.g.
+//
+//   ow_sweep busJitter=0,1000,2000 master.read_sample=5:30:1 master.slot=61:120:1
+//
+// sweeps the product of the three. A transaction is a read ROM and a skip ROM + read scratchpad,
+// it succeeds when both resets see a presence pulse, both CRCs match and the ROM is the chip's.
+//
+// Every point runs in a process of its own, forked from here, so nothing the chip or the kernel
+// keeps in globals carries over from one point to the next. Up to jobs (the number of cores by
+// default) run at once and the next point goes to whichever finishes first; the results come
+// back through shared memory and are written out in grid order.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "sim.h"
+#include "ow_master.h"
+#include "ow_crc.h"
+
+#define MAX_PARAMS      16
+#define MAX_VALUES      4096
+#define MAX_OVERRIDES   16
+#define DEVICE_ID       "0a1b2c3d4e5f"
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_sweep [-j jobs] [-n transactions] [-o results.csv] [-a name=value]... [-v] param=values...\n");
+    exit(2);
+}
+
+typedef struct {
+    char name[48];
+    bool master;            // a master timing rather than a chip attribute
+    double *values;
+    uint32_t num_values;
+} param_t;
+
+typedef struct {
+    bool done;
+    uint32_t ok;
+    uint32_t resets;
+    uint32_t presences;
+    double sim_s;
+    double wall_s;
+    uint64_t events;
+} result_t;
+
+static struct {
+    param_t params[MAX_PARAMS];
+    int num_params;
+    const char *overrides[MAX_OVERRIDES];
+    int num_overrides;
+    long transactions;
+    bool verbose;
+} cfg;
+
+static void add_value(param_t *p, double v) {
+    if (p->num_values == MAX_VALUES) {
+        fprintf(stderr, "%s: more than %d values\n", p->name, MAX_VALUES);
+        exit(2);
+    }
+    p->values[p->num_values++] = v;
+}
+
+// name=v,lo:hi:step,...
+static void parse_param(const char *arg) {
+    const char *eq = strchr(arg, '=');
+    if (eq == NULL || eq == arg || cfg.num_params == MAX_PARAMS) usage();
+    param_t *p = &cfg.params[cfg.num_params++];
+    snprintf(p->name, sizeof(p->name), "%.*s", (int)(eq - arg), arg);
+    p->values = malloc(MAX_VALUES * sizeof(double));
+
+    if (!strncmp(p->name, "master.", 7)) {
+        ow_master_timing_t t;
+        p->master = true;
+        if (ow_master_timing_field(&t, p->name + 7) == NULL) {
+            fprintf(stderr, "unknown master timing %s\n", p->name);
+            exit(2);
+        }
+    }
+
+    for (const char *s = eq + 1; *s; s += *s == ',') {
+        char *end;
+        double lo = strtod(s, &end), hi, step;
+        if (end == s) usage();
+        if (*end != ':') {
+            add_value(p, lo);
+            s = end;
+            continue;
+        }
+        hi = strtod(end + 1, &end);
+        if (*end != ':') usage();
+        step = strtod(end + 1, &end);
+        if (step <= 0 || hi < lo) usage();
+        // count the steps rather than accumulate them, so the last value isn't lost to rounding
+        long steps = (long)floor((hi - lo) / step + 1e-9);
+        for (long i = 0; i <= steps; i++) add_value(p, lo + i * step);
+        s = end;
+    }
+    if (p->num_values == 0) usage();
+}
+
+// the values of point k, the last parameter varies fastest
+static void point_values(long k, double *v) {
+    for (int i = cfg.num_params - 1; i >= 0; i--) {
+        v[i] = cfg.params[i].values[k % cfg.params[i].num_values];
+        k /= cfg.params[i].num_values;
+    }
+}
+
+static int read_rom(ow_master_t *m, const uint8_t rom[8]) {
+    ow_master_rx_clear(m);
+    ow_master_reset(m);
+    ow_master_write(m, (const uint8_t[]){0x33}, 1);
+    ow_master_read(m, 8);
+    sim_run_until(m->t);
+    return crc8(m->rx, 7) == m->rx[7] && !memcmp(m->rx, rom, 8);
+}
+
+static int read_scratchpad(ow_master_t *m) {
+    ow_master_rx_clear(m);
+    ow_master_reset(m);
+    ow_master_write(m, (const uint8_t[]){0xCC, 0xBE}, 2);
+    ow_master_read(m, 9);
+    sim_run_until(m->t);
+    return crc8(m->rx, 8) == m->rx[8];
+}
+
+static void run_point(long k, result_t *r) {
+    double v[MAX_PARAMS];
+    point_values(k, v);
+
+    sim_net_t dq = sim_net_new("DQ");
+    sim_net_t vcc = sim_net_new("VCC");
+    sim_net_force(vcc, HIGH);
+    sim_chip_t *chip = sim_chip_new("ds");
+    sim_chip_attr(chip, "deviceID", DEVICE_ID);
+    sim_chip_attr(chip, "genDebug", "0");
+    for (int i = 0; i < cfg.num_overrides; i++) {
+        if (sim_chip_attr_arg(chip, cfg.overrides[i]) < 0) usage();
+    }
+    for (int i = 0; i < cfg.num_params; i++) {
+        if (!cfg.params[i].master) {
+            char value[32];
+            snprintf(value, sizeof(value), "%.10g", v[i]);
+            sim_chip_attr(chip, cfg.params[i].name, value);
+        }
+    }
+    sim_chip_bind(chip, "DQ", dq);
+    sim_chip_bind(chip, "VCC", vcc);
+    sim_chip_call(chip, chip_init);
+
+    sim_net_pullup(dq, true);
+    ow_master_t m;
+    ow_master_init(&m, dq);
+    for (int i = 0; i < cfg.num_params; i++) {
+        if (cfg.params[i].master) {
+            *ow_master_timing_field(&m.timing, cfg.params[i].name + 7) = (uint32_t)lround(v[i] * 1000);
+        }
+    }
+
+    // the ROM the chip should answer with, family code and serial LSB first
+    uint8_t rom[8], family = 0x10;
+    for (int i = 0; i < cfg.num_overrides; i++) {
+        if (!strncmp(cfg.overrides[i], "familyCode=", 11)) family = strtoul(cfg.overrides[i] + 11, NULL, 0);
+    }
+    ow_master_rom(rom, family, strtoull(DEVICE_ID, NULL, 16));
+
+    double t0 = sim_wall_s();
+    for (long i = 0; i < cfg.transactions; i++) {
+        int ok = read_rom(&m, rom);
+        ok &= read_scratchpad(&m);
+        r->ok += ok;
+    }
+    r->wall_s = sim_wall_s() - t0;
+    r->sim_s = sim_now() / 1e9;
+    r->events = sim_events();
+    r->resets = m.resets;
+    r->presences = m.presences;
+    r->done = true;
+}
+
+static void write_csv(FILE *f, const result_t *results, long points) {
+    for (int i = 0; i < cfg.num_params; i++) fprintf(f, "%s,", cfg.params[i].name);
+    fprintf(f, "transactions,ok,success,resets,presences,sim_s,wall_s,tx_per_sim_s,tx_per_wall_s,events\n");
+    for (long k = 0; k < points; k++) {
+        const result_t *r = &results[k];
+        double v[MAX_PARAMS];
+        point_values(k, v);
+        for (int i = 0; i < cfg.num_params; i++) fprintf(f, "%.10g,", v[i]);
+        if (!r->done) {
+            fprintf(f, "%ld,,,,,,,,,\n", cfg.transactions);
+            continue;
+        }
+        fprintf(f, "%ld,%u,%.4f,%u,%u,%.6f,%.6f,%.2f,%.1f,%llu\n", cfg.transactions, r->ok,
+                (double)r->ok / cfg.transactions, r->resets, r->presences, r->sim_s, r->wall_s,
+                r->sim_s > 0 ? cfg.transactions / r->sim_s : 0, r->wall_s > 0 ? cfg.transactions / r->wall_s : 0,
+                (unsigned long long)r->events);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *out = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.transactions = 20;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) {
+            cfg.verbose = true;
+            continue;
+        }
+        if (argv[i][0] != '-') {
+            parse_param(argv[i]);
+            continue;
+        }
+        if (i + 1 >= argc) usage();
+        if (!strcmp(argv[i], "-j")) jobs = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-n")) cfg.transactions = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-o")) out = argv[++i];
+        else if (!strcmp(argv[i], "-a") && cfg.num_overrides < MAX_OVERRIDES) cfg.overrides[cfg.num_overrides++] = argv[++i];
+        else usage();
+    }
+    if (jobs <= 0 || cfg.transactions <= 0) usage();
+
+    long points = 1;
+    for (int i = 0; i < cfg.num_params; i++) points *= cfg.params[i].num_values;
+
+    result_t *results = mmap(NULL, points * sizeof(result_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    fflush(stdout);
+    double t0 = sim_wall_s();
+    long next = 0, running = 0, failed = 0;
+    while (next < points || running > 0) {
+        if (next < points && running < jobs) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (pid == 0) {
+                if (!cfg.verbose) freopen("/dev/null", "w", stdout);
+                run_point(next, &results[next]);
+                exit(0);
+            }
+            next++;
+            running++;
+            continue;
+        }
+        int status;
+        if (wait(&status) < 0) break;
+        running--;
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    double dt = sim_wall_s() - t0;
+
+    FILE *f = out ? fopen(out, "w") : stdout;
+    if (f == NULL) {
+        perror(out);
+        return 1;
+    }
+    write_csv(f, results, points);
+    if (out) fclose(f);
+    fprintf(stderr, "%ld points, %ld jobs, %.3f s, %.1f points/s%s\n", points, jobs, dt, points / dt,
+            failed ? ", some points did not complete" : "");
+    return failed != 0;
+}
@@ -0,0 +1,250 @@
+// Binary bus capture format - mmap reader and streaming writer
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "owcap.h"
+
+// ==================== reader =========================
+
+int owcap_open(owcap_t *cap, const char *path) {
+    memset(cap, 0, sizeof(owcap_t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(owcap_header_t)) {
+        close(fd);
+        return -2;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+
+    const owcap_header_t *hdr = base;
+    if (memcmp(hdr->magic, OWCAP_MAGIC, sizeof(hdr->magic))) {
+        munmap(base, st.st_size);
+        return -2;
+    }
+    if (hdr->num_wires == 0 || hdr->num_wires > OWCAP_MAX_WIRES || hdr->window_ns == 0 ||
+        hdr->data_offset + hdr->data_len > (uint64_t)st.st_size ||
+        hdr->index_offset + hdr->num_windows * sizeof(owcap_window_t) > (uint64_t)st.st_size) {
+        fprintf(stderr, "%s: corrupt capture header\n", path);
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    cap->base = base;
+    cap->size = st.st_size;
+    cap->hdr = hdr;
+    cap->names = (const char (*)[OWCAP_NAME_LEN])(cap->base + sizeof(owcap_header_t));
+    cap->index = (const owcap_window_t *)(cap->base + hdr->index_offset);
+    // the records are read front to back
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void owcap_close(owcap_t *cap) {
+    if (cap->base) munmap((void *)cap->base, cap->size);
+    memset(cap, 0, sizeof(owcap_t));
+}
+
+int owcap_wire(const owcap_t *cap, const char *name) {
+    for (uint32_t i = 0; i < cap->hdr->num_wires; i++) {
+        if (!strncmp(cap->names[i], name, OWCAP_NAME_LEN)) return i;
+    }
+    return -1;
+}
+
+int owcap_next(owcap_cursor_t *cur) {
+    const uint8_t *p = cur->p;
+    if (p >= cur->end) {
+        return 0;
+    }
+
+    uint64_t delta = 0;
+    for (int shift = 0; p < cur->end; shift += 7) {
+        uint8_t b = *p++;
+        delta |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    uint64_t state = 0;
+    for (uint32_t i = 0; i < cur->cap->hdr->state_len && p < cur->end; i++) {
+        state |= (uint64_t)*p++ << (8 * i);
+    }
+
+    cur->p = p;
+    cur->time += delta;
+    cur->changed = cur->state ^ state;
+    cur->state = state;
+    return 1;
+}
+
+void owcap_seek(owcap_cursor_t *cur, const owcap_t *cap, uint64_t time_ns) {
+    const owcap_header_t *hdr = cap->hdr;
+    const uint8_t *data = cap->base + hdr->data_offset;
+
+    memset(cur, 0, sizeof(owcap_cursor_t));
+    cur->cap = cap;
+    cur->end = data + hdr->data_len;
+    cur->time = hdr->start_ns;
+    cur->state = hdr->initial;
+    if (hdr->num_windows == 0) {
+        cur->p = cur->end;
+        return;
+    }
+
+    uint64_t k = time_ns < hdr->start_ns ? 0 : (time_ns - hdr->start_ns) / hdr->window_ns;
+    if (k >= hdr->num_windows) k = hdr->num_windows - 1;
+    cur->p = data + cap->index[k].offset;
+    cur->time = cap->index[k].time;
+    cur->state = cap->index[k].state;
+
+    // skip the records of the window before time_ns
+    for (;;) {
+        owcap_cursor_t prev = *cur;
+        if (!owcap_next(cur)) break;
+        if (cur->time >= time_ns) {
+            *cur = prev;
+            break;
+        }
+    }
+    cur->changed = 0;
+}
+
+// ==================== writer =========================
+
+static int put_varint(owcap_writer_t *w, uint64_t v) {
+    uint8_t buf[10];
+    int n = 0;
+    do {
+        buf[n] = v & 0x7F;
+        v >>= 7;
+        if (v) buf[n] |= 0x80;
+        n++;
+    } while (v);
+    w->pos += n;
+    return fwrite(buf, 1, n, w->f) == (size_t)n ? 0 : -1;
+}
+
+static int emit(owcap_writer_t *w, uint64_t time, uint64_t state) {
+    owcap_header_t *hdr = &w->hdr;
+
+    if (hdr->num_records == 0) {
+        hdr->start_ns = time;
+        w->time = time;
+    }
+    // index entries for the windows up to this record, empty ones point at it too
+    while (time >= hdr->start_ns + hdr->num_windows * hdr->window_ns) {
+        if (hdr->num_windows == w->cap_index) {
+            w->cap_index = w->cap_index ? w->cap_index * 2 : 1024;
+            w->index = realloc(w->index, w->cap_index * sizeof(owcap_window_t));
+            if (w->index == NULL) return -1;
+        }
+        w->index[hdr->num_windows++] = (owcap_window_t){w->pos, w->time, w->state};
+    }
+
+    if (put_varint(w, time - w->time) < 0) {
+        return -1;
+    }
+    uint8_t buf[OWCAP_MAX_WIRES / 8];
+    for (uint32_t i = 0; i < hdr->state_len; i++) buf[i] = state >> (8 * i);
+    if (fwrite(buf, 1, hdr->state_len, w->f) != hdr->state_len) {
+        return -1;
+    }
+    w->pos += hdr->state_len;
+    w->time = time;
+    w->state = state;
+    hdr->num_records++;
+    return 0;
+}
+
+// write the pending record if it changes anything
+static int flush_pending(owcap_writer_t *w) {
+    if (!w->has_pending) {
+        return 0;
+    }
+    w->has_pending = 0;
+    return w->pending == w->state ? 0 : emit(w, w->pending_time, w->pending);
+}
+
+int owcap_create(owcap_writer_t *w, const char *path, const char names[][OWCAP_NAME_LEN], uint32_t num_wires,
+                 uint64_t window_ns, uint64_t initial) {
+    memset(w, 0, sizeof(owcap_writer_t));
+    if (num_wires == 0 || num_wires > OWCAP_MAX_WIRES) {
+        fprintf(stderr, "%s: %u wires, 1 to %d supported\n", path, num_wires, OWCAP_MAX_WIRES);
+        return -1;
+    }
+    w->f = fopen(path, "wb");
+    if (w->f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    owcap_header_t *hdr = &w->hdr;
+    memcpy(hdr->magic, OWCAP_MAGIC, sizeof(hdr->magic));
+    hdr->num_wires = num_wires;
+    hdr->state_len = (num_wires + 7) / 8;
+    hdr->window_ns = window_ns ? window_ns : OWCAP_DEF_WINDOW;
+    hdr->data_offset = sizeof(owcap_header_t) + num_wires * OWCAP_NAME_LEN;
+    hdr->initial = initial;
+    w->state = initial;
+
+    // the header is rewritten by owcap_finish
+    fwrite(hdr, sizeof(owcap_header_t), 1, w->f);
+    for (uint32_t i = 0; i < num_wires; i++) {
+        char name[OWCAP_NAME_LEN] = {0};
+        strncpy(name, names[i], OWCAP_NAME_LEN - 1);
+        fwrite(name, OWCAP_NAME_LEN, 1, w->f);
+    }
+    return ferror(w->f) ? -1 : 0;
+}
+
+int owcap_write(owcap_writer_t *w, uint64_t time_ns, uint64_t state) {
+    if (w->has_pending && time_ns < w->pending_time) {
+        fprintf(stderr, "capture: time going backwards at %llu ns\n", (unsigned long long)time_ns);
+        return -1;
+    }
+    if (!w->has_pending || time_ns != w->pending_time) {
+        if (flush_pending(w) < 0) return -1;
+    }
+    w->pending = state;
+    w->pending_time = time_ns;
+    w->has_pending = 1;
+    return 0;
+}
+
+int owcap_finish(owcap_writer_t *w) {
+    owcap_header_t *hdr = &w->hdr;
+    int err = flush_pending(w);
+
+    hdr->data_len = w->pos;
+    hdr->end_ns = w->time;
+    static const uint8_t pad[8];
+    uint64_t end = hdr->data_offset + w->pos;
+    fwrite(pad, 1, -end & 7, w->f);
+    hdr->index_offset = end + (-end & 7);
+    fwrite(w->index, sizeof(owcap_window_t), hdr->num_windows, w->f);
+
+    fseek(w->f, 0, SEEK_SET);
+    fwrite(hdr, sizeof(owcap_header_t), 1, w->f);
+    err |= ferror(w->f);
+    err |= fclose(w->f);
+    free(w->index);
+    w->f = NULL;
+    w->index = NULL;
+    return err ? -1 : 0;
+}
@@ -0,0 +1,98 @@
+//
+// Binary bus capture format for the host build. A capture is a header, the wire names, a stream of
+// records and a window index:
+//
+//   record   varint time delta from the previous record, ns (LEB128)
+//            state of all wires after the change, one bit per wire, (num_wires + 7) / 8 bytes
+//
+// Changes at the same timestamp are merged into one record. The index has an entry per window of
+// window_ns from start_ns with the offset of the first record in the window, the time of the record
+// before it and the wire states at that point, so a reader can start decoding anywhere. All fields
+// are little endian, the header and index are 8 byte aligned so the file can be used in place
+// through mmap.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OWCAP_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OWCAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define OWCAP_MAGIC         "OWCAP\0\0\1"
+#define OWCAP_MAX_WIRES     64
+#define OWCAP_NAME_LEN      16
+#define OWCAP_DEF_WINDOW    10000000ull     // 10 ms
+
+typedef struct owcap_header {
+    char magic[8];
+    uint32_t num_wires;
+    uint32_t state_len;         // bytes per record state
+    uint64_t window_ns;
+    uint64_t start_ns;          // time of the first record
+    uint64_t end_ns;            // time of the last record
+    uint64_t num_records;
+    uint64_t num_windows;
+    uint64_t data_offset;
+    uint64_t data_len;
+    uint64_t index_offset;
+    uint64_t initial;           // wire states before the first record
+} owcap_header_t;
+
+typedef struct owcap_window {
+    uint64_t offset;            // first record at or after the window start, data_offset based
+    uint64_t time;              // time of the record before it, start_ns for the first window
+    uint64_t state;             // wire states before it
+} owcap_window_t;
+
+// reader, the file is mapped read only
+typedef struct owcap {
+    const uint8_t *base;
+    size_t size;
+    const owcap_header_t *hdr;
+    const char (*names)[OWCAP_NAME_LEN];
+    const owcap_window_t *index;
+} owcap_t;
+
+typedef struct owcap_cursor {
+    const owcap_t *cap;
+    const uint8_t *p, *end;
+    uint64_t time;              // time of the current record
+    uint64_t state;             // wire states after it
+    uint64_t changed;           // wires that changed with it
+} owcap_cursor_t;
+
+// map path. Returns 0 on success, -1 with a message on stderr, -2 quietly if it's not a capture
+int owcap_open(owcap_t *cap, const char *path);
+void owcap_close(owcap_t *cap);
+// index of the wire with the given name, -1 if there's none
+int owcap_wire(const owcap_t *cap, const char *name);
+// position the cursor before the first record at or after time_ns, the state is the one at time_ns
+void owcap_seek(owcap_cursor_t *cur, const owcap_t *cap, uint64_t time_ns);
+// advance to the next record. Returns 0 at the end of the capture
+int owcap_next(owcap_cursor_t *cur);
+
+// writer, records are appended as they come and the index and header are written by owcap_finish
+typedef struct owcap_writer {
+    FILE *f;
+    owcap_header_t hdr;
+    owcap_window_t *index;
+    uint64_t cap_index;
+    uint64_t pos;               // data bytes written
+    uint64_t time;              // time of the last record
+    uint64_t state;
+    uint64_t pending;           // states of a record not written yet, merges changes at one time
+    uint64_t pending_time;
+    int has_pending;
+} owcap_writer_t;
+
+int owcap_create(owcap_writer_t *w, const char *path, const char names[][OWCAP_NAME_LEN], uint32_t num_wires,
+                 uint64_t window_ns, uint64_t initial);
+// wire states from time_ns on, times must not go backwards. Unchanged states are dropped
+int owcap_write(owcap_writer_t *w, uint64_t time_ns, uint64_t state);
+int owcap_finish(owcap_writer_t *w);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OWCAP_H
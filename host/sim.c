@@ -0,0 +1,650 @@
+// Native host stand-in for the Wokwi simulator - event kernel, nets and the wokwi-api.h imports
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sim.h"
+#include "twheel.h"
+
+#define NAME_LEN    48
+#define MAX_BINDS   16
+
+// grow a dynamic array so that index n fits
+#define GROW(arr, n, cap) { \
+    if ((n) >= (cap)) { \
+        (cap) = (cap) ? (cap) * 2 : 64; \
+        (arr) = realloc((arr), (cap) * sizeof(*(arr))); \
+        if ((arr) == NULL) { fprintf(stderr, "sim: out of memory\n"); exit(1); } \
+    } \
+}
+
+typedef struct {
+    uint64_t time;
+    uint64_t seq;
+    sim_fn fn;
+    void *arg;
+    uint32_t data;
+} event_t;
+
+typedef struct {
+    char name[NAME_LEN];
+    uint32_t level;
+    int8_t force;           // -1 when not forced
+    bool pullup;
+    uint32_t low;           // pins driving low
+    uint32_t high;          // pins pulling or driving high
+    float voltage;
+    sim_net_probe_fn probe;
+    void *probe_user;
+    pin_t *pins;
+    uint32_t num_pins, cap_pins;
+} net_t;
+
+typedef struct {
+    sim_net_t net;
+    uint32_t mode;
+    uint32_t value;
+    bool drives_low;
+    bool pulls_high;
+    bool watching;
+    pin_watch_config_t watch;
+} pin_rec_t;
+
+// a timer's wheel node has the timer's index
+typedef struct {
+    timer_config_t cfg;
+    uint32_t gen;           // heap timers: bumped on every start/stop, events of older generations are stale
+    uint64_t period;
+    bool repeat;
+} timer_rec_t;
+
+typedef struct {
+    sim_chip_t *chip;
+    char name[NAME_LEN];
+    bool is_float;
+    uint32_t def_u;
+    float def_f;
+    uint32_t u;
+    float f;
+} attr_rec_t;
+
+typedef struct {
+    sim_chip_t *chip;
+    char name[NAME_LEN];    // attribute it came from, empty for other strings
+    char *value;
+} string_rec_t;
+
+typedef struct {
+    uart_config_t cfg;
+    sim_chip_t *chip;
+    bool busy;
+} uart_rec_t;
+
+typedef struct {
+    char name[NAME_LEN];
+    char *value;
+} chip_attr_t;
+
+struct sim_chip {
+    char id[NAME_LEN];
+    chip_attr_t *attrs;
+    uint32_t num_attrs, cap_attrs;
+    struct {
+        char pin[NAME_LEN];
+        sim_net_t net;
+    } binds[MAX_BINDS];
+    uint32_t num_binds;
+};
+
+static struct {
+    uint64_t now;
+    uint64_t seq;
+    uint64_t events;
+    event_t *heap;
+    uint32_t heap_len, heap_cap;
+
+    net_t *nets;
+    uint32_t num_nets, cap_nets;
+    pin_rec_t *pins;
+    uint32_t num_pins, cap_pins;
+    timer_rec_t *timers;
+    uint32_t num_timers, cap_timers;
+    twheel_t wheel;
+    bool timer_heap;            // timers as heap events instead of on the wheel
+    attr_rec_t *attrs;
+    uint32_t num_attrs, cap_attrs;
+    string_rec_t *strings;
+    uint32_t num_strings, cap_strings;
+    uart_rec_t *uarts;
+    uint32_t num_uarts, cap_uarts;
+
+    sim_chip_t *cur_chip;       // target of pin_init/attr_init, set by sim_chip_call
+    sim_uart_sink uart_sink;
+    void *uart_sink_data;
+} sim;
+
+// ==================== kernel =========================
+
+static inline bool ev_before(const event_t *a, const event_t *b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+void sim_reset(void) {
+    free(sim.heap);
+    tw_free(&sim.wheel);
+    for (uint32_t i = 0; i < sim.num_nets; i++) free(sim.nets[i].pins);
+    free(sim.nets);
+    free(sim.pins);
+    free(sim.timers);
+    free(sim.attrs);
+    for (uint32_t i = 0; i < sim.num_strings; i++) free(sim.strings[i].value);
+    free(sim.strings);
+    free(sim.uarts);
+    memset(&sim, 0, sizeof(sim));
+}
+
+uint64_t sim_now(void) { return sim.now; }
+uint64_t sim_events(void) { return sim.events; }
+
+void sim_at(uint64_t time_ns, sim_fn fn, void *arg, uint32_t data) {
+    GROW(sim.heap, sim.heap_len, sim.heap_cap);
+    event_t e = {time_ns < sim.now ? sim.now : time_ns, sim.seq++, fn, arg, data};
+
+    // sift up, moving the hole rather than swapping
+    uint32_t i = sim.heap_len++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!ev_before(&e, &sim.heap[parent])) break;
+        sim.heap[i] = sim.heap[parent];
+        i = parent;
+    }
+    sim.heap[i] = e;
+}
+
+static event_t pop_event(void) {
+    event_t top = sim.heap[0];
+    event_t last = sim.heap[--sim.heap_len];
+    uint32_t n = sim.heap_len;
+    uint32_t i = 0;
+
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && ev_before(&sim.heap[c + 1], &sim.heap[c])) c++;
+        if (!ev_before(&sim.heap[c], &last)) break;
+        sim.heap[i] = sim.heap[c];
+        i = c;
+    }
+    if (n > 0) {
+        sim.heap[i] = last;
+    }
+    return top;
+}
+
+static void timer_expire(uint32_t id);
+
+// events and wheel timers up to limit, merged by time and scheduling order
+static void run_events(uint64_t limit) {
+    for (;;) {
+        bool have_event = sim.heap_len > 0 && sim.heap[0].time <= limit;
+        if (sim.num_timers > 0 && sim.wheel.count > 0) {
+            uint32_t id = tw_first(&sim.wheel, have_event ? sim.heap[0].time : limit);
+            if (id != TW_NIL) {
+                tw_node_t *n = tw_node(&sim.wheel, id);
+                if (!have_event || n->time < sim.heap[0].time || (n->time == sim.heap[0].time && n->seq < sim.heap[0].seq)) {
+                    timer_expire(id);
+                    continue;
+                }
+            }
+        }
+        if (!have_event) {
+            break;
+        }
+        event_t e = pop_event();
+        sim.now = e.time;
+        sim.events++;
+        e.fn(e.arg, e.data);
+    }
+}
+
+void sim_run_until(uint64_t time_ns) {
+    run_events(time_ns);
+    if (time_ns > sim.now) {
+        sim.now = time_ns;
+    }
+}
+
+void sim_run(void) {
+    run_events(UINT64_MAX);
+}
+
+void sim_timer_heap(bool on) {
+    sim.timer_heap = on;
+}
+
+// ==================== nets and pins =========================
+
+sim_net_t sim_net_new(const char *name) {
+    GROW(sim.nets, sim.num_nets, sim.cap_nets);
+    net_t *n = &sim.nets[sim.num_nets];
+    memset(n, 0, sizeof(net_t));
+    snprintf(n->name, sizeof(n->name), "%s", name);
+    n->force = -1;
+    return sim.num_nets++;
+}
+
+sim_net_t sim_net_find(const char *name) {
+    for (uint32_t i = 0; i < sim.num_nets; i++) {
+        if (!strcmp(sim.nets[i].name, name)) return i;
+    }
+    return SIM_NO_NET;
+}
+
+const char *sim_net_name(sim_net_t net) {
+    return sim.nets[net].name;
+}
+
+static uint32_t net_resolve(const net_t *n) {
+    if (n->force >= 0) return n->force;
+    if (n->low > 0) return LOW;
+    return n->high > 0 || n->pullup ? HIGH : LOW;
+}
+
+static void net_update(sim_net_t net) {
+    net_t *n = &sim.nets[net];
+    uint32_t level = net_resolve(n);
+    if (level == n->level) {
+        return;
+    }
+    n->level = level;
+
+    for (uint32_t i = 0; i < sim.nets[net].num_pins; i++) {
+        pin_t p = sim.nets[net].pins[i];
+        pin_rec_t *pr = &sim.pins[p];
+        if (!pr->watching) continue;
+        if (!(pr->watch.edge & (level == HIGH ? RISING : FALLING))) continue;
+        pr->watch.pin_change(pr->watch.user_data, p, level);
+        // a watcher changed the net again, the nested update has told everyone about the new level
+        if (sim.nets[net].level != level) return;
+    }
+}
+
+void sim_net_pullup(sim_net_t net, bool on) {
+    sim.nets[net].pullup = on;
+    net_update(net);
+}
+
+void sim_net_force(sim_net_t net, int level) {
+    sim.nets[net].force = level;
+    net_update(net);
+}
+
+void sim_net_set_voltage(sim_net_t net, float v) {
+    sim.nets[net].voltage = v;
+}
+
+uint32_t sim_net_level(sim_net_t net) {
+    return sim.nets[net].level;
+}
+
+uint32_t sim_net_drivers(sim_net_t net) {
+    return sim.nets[net].low;
+}
+
+void sim_net_probe(sim_net_t net, sim_net_probe_fn fn, void *user) {
+    sim.nets[net].probe = fn;
+    sim.nets[net].probe_user = user;
+}
+
+// recompute what the pin contributes to its net
+static void pin_apply(pin_t pin) {
+    pin_rec_t *p = &sim.pins[pin];
+    net_t *n = &sim.nets[p->net];
+    bool low = p->mode == OUTPUT && p->value == LOW;
+    bool high = p->mode == INPUT_PULLUP || (p->mode == OUTPUT && p->value == HIGH);
+
+    n->low += (int)low - (int)p->drives_low;
+    n->high += (int)high - (int)p->pulls_high;
+    if (low != p->drives_low && n->probe) {
+        p->drives_low = low;
+        n->probe(n->probe_user, n->low);
+    }
+    p->drives_low = low;
+    p->pulls_high = high;
+    net_update(p->net);
+}
+
+static pin_t pin_new(sim_net_t net, uint32_t mode) {
+    GROW(sim.pins, sim.num_pins, sim.cap_pins);
+    pin_t pin = sim.num_pins++;
+    memset(&sim.pins[pin], 0, sizeof(pin_rec_t));
+    sim.pins[pin].net = net;
+
+    net_t *n = &sim.nets[net];
+    GROW(n->pins, n->num_pins, n->cap_pins);
+    n->pins[n->num_pins++] = pin;
+
+    pin_mode(pin, mode);
+    return pin;
+}
+
+pin_t sim_pin_new(sim_net_t net, const char *name, uint32_t mode) {
+    (void)name;
+    return pin_new(net, mode);
+}
+
+pin_t pin_init(const char *name, uint32_t mode) {
+    sim_chip_t *chip = sim.cur_chip;
+    sim_net_t net = chip ? sim_chip_net(chip, name) : SIM_NO_NET;
+
+    // unconnected pins get a net of their own
+    if (net == SIM_NO_NET) {
+        char net_name[2 * NAME_LEN];
+        snprintf(net_name, sizeof(net_name), "%s:%s", chip ? chip->id : "?", name);
+        net = sim_net_new(net_name);
+        if (chip) sim_chip_bind(chip, name, net);
+    }
+    return pin_new(net, mode);
+}
+
+uint32_t pin_read(pin_t pin) {
+    return sim.nets[sim.pins[pin].net].level;
+}
+
+void pin_write(pin_t pin, uint32_t value) {
+    sim.pins[pin].value = value;
+    pin_apply(pin);
+}
+
+void pin_mode(pin_t pin, uint32_t value) {
+    pin_rec_t *p = &sim.pins[pin];
+    if (value == OUTPUT_LOW || value == OUTPUT_HIGH) {
+        p->value = value == OUTPUT_HIGH;
+        value = OUTPUT;
+    }
+    p->mode = value;
+    pin_apply(pin);
+}
+
+bool pin_watch(pin_t pin, const pin_watch_config_t *config) {
+    sim.pins[pin].watch = *config;
+    sim.pins[pin].watching = true;
+    return true;
+}
+
+void pin_watch_stop(pin_t pin) {
+    sim.pins[pin].watching = false;
+}
+
+float pin_adc_read(pin_t pin) {
+    return sim.nets[sim.pins[pin].net].voltage;
+}
+
+float pin_dac_write(pin_t pin, float voltage) {
+    sim.nets[sim.pins[pin].net].voltage = voltage;
+    return voltage;
+}
+
+// ==================== timers =========================
+
+// heap timers
+static void timer_fire(void *arg, uint32_t gen) {
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    timer_rec_t *t = &sim.timers[id];
+    if (gen != t->gen) {
+        return;
+    }
+    if (t->repeat) {
+        sim_at(sim.now + t->period, timer_fire, arg, gen);
+    }
+    t->cfg.callback(t->cfg.user_data);
+}
+
+// wheel timers, the node is taken off when it expires and on stop, so there are no stale entries
+static void timer_expire(uint32_t id) {
+    timer_rec_t *t = &sim.timers[id];
+    tw_node_t *n = tw_node(&sim.wheel, id);
+    tw_del(&sim.wheel, id);
+    sim.now = n->time;
+    sim.events++;
+    if (t->repeat) {
+        tw_add(&sim.wheel, id, sim.now + t->period, sim.seq++);
+    }
+    t->cfg.callback(t->cfg.user_data);
+}
+
+timer_t timer_init(const timer_config_t *config) {
+    if (sim.num_timers == 0) {
+        tw_init(&sim.wheel);
+    }
+    GROW(sim.timers, sim.num_timers, sim.cap_timers);
+    timer_rec_t *t = &sim.timers[sim.num_timers];
+    memset(t, 0, sizeof(timer_rec_t));
+    t->cfg = *config;
+    tw_node_new(&sim.wheel);
+    return sim.num_timers++;
+}
+
+void timer_start_ns_d(const timer_t timer, double nanos, bool repeat) {
+    timer_rec_t *t = &sim.timers[timer];
+    t->period = nanos > 0 ? (uint64_t)nanos : 0;
+    t->repeat = repeat && t->period > 0;
+    if (!sim.timer_heap) {
+        tw_del(&sim.wheel, timer);
+        tw_add(&sim.wheel, timer, sim.now + t->period, sim.seq++);
+        return;
+    }
+    t->gen++;
+    sim_at(sim.now + t->period, timer_fire, (void *)(uintptr_t)timer, t->gen);
+}
+
+void timer_start(const timer_t timer, uint32_t micros, bool repeat) {
+    timer_start_ns_d(timer, micros * 1000.0, repeat);
+}
+
+void timer_stop(const timer_t timer) {
+    sim.timers[timer].gen++;
+    tw_del(&sim.wheel, timer);
+}
+
+double get_sim_nanos_d(void) {
+    return (double)sim.now;
+}
+
+// ==================== chips and attributes =========================
+
+sim_chip_t *sim_chip_new(const char *id) {
+    sim_chip_t *chip = calloc(1, sizeof(sim_chip_t));
+    snprintf(chip->id, sizeof(chip->id), "%s", id);
+    return chip;
+}
+
+const char *sim_chip_id(const sim_chip_t *chip) {
+    return chip->id;
+}
+
+static chip_attr_t *chip_attr_find(const sim_chip_t *chip, const char *name) {
+    for (uint32_t i = 0; i < chip->num_attrs; i++) {
+        if (!strcmp(chip->attrs[i].name, name)) return &chip->attrs[i];
+    }
+    return NULL;
+}
+
+void sim_chip_attr(sim_chip_t *chip, const char *name, const char *value) {
+    chip_attr_t *a = chip_attr_find(chip, name);
+    if (a == NULL) {
+        GROW(chip->attrs, chip->num_attrs, chip->cap_attrs);
+        a = &chip->attrs[chip->num_attrs++];
+        snprintf(a->name, sizeof(a->name), "%s", name);
+        a->value = NULL;
+    }
+    free(a->value);
+    a->value = strdup(value);
+}
+
+int sim_chip_attr_arg(sim_chip_t *chip, const char *assignment) {
+    char name[NAME_LEN];
+    const char *eq = strchr(assignment, '=');
+    if (eq == NULL || eq == assignment || eq - assignment >= (long)sizeof(name)) {
+        return -1;
+    }
+    snprintf(name, eq - assignment + 1, "%s", assignment);
+    sim_chip_attr(chip, name, eq + 1);
+    return 0;
+}
+
+void sim_chip_bind(sim_chip_t *chip, const char *pin_name, sim_net_t net) {
+    for (uint32_t i = 0; i < chip->num_binds; i++) {
+        if (!strcmp(chip->binds[i].pin, pin_name)) {
+            chip->binds[i].net = net;
+            return;
+        }
+    }
+    if (chip->num_binds == MAX_BINDS) {
+        fprintf(stderr, "sim: %s has too many pins\n", chip->id);
+        return;
+    }
+    snprintf(chip->binds[chip->num_binds].pin, NAME_LEN, "%s", pin_name);
+    chip->binds[chip->num_binds++].net = net;
+}
+
+sim_net_t sim_chip_net(const sim_chip_t *chip, const char *pin_name) {
+    for (uint32_t i = 0; i < chip->num_binds; i++) {
+        if (!strcmp(chip->binds[i].pin, pin_name)) return chip->binds[i].net;
+    }
+    return SIM_NO_NET;
+}
+
+void sim_chip_call(sim_chip_t *chip, void (*fn)(void)) {
+    sim_chip_t *prev = sim.cur_chip;
+    sim.cur_chip = chip;
+    fn();
+    sim.cur_chip = prev;
+}
+
+static void attr_load(attr_rec_t *a) {
+    const chip_attr_t *ca = a->chip ? chip_attr_find(a->chip, a->name) : NULL;
+    if (ca == NULL) {
+        a->u = a->def_u;
+        a->f = a->def_f;
+        return;
+    }
+    // attribute values are strings in the diagram, numbers are parsed the same way for both kinds
+    double v = strtod(ca->value, NULL);
+    a->f = (float)v;
+    a->u = (uint32_t)(int64_t)v;
+}
+
+uint32_t attr_init(const char *name, uint32_t default_value) {
+    GROW(sim.attrs, sim.num_attrs, sim.cap_attrs);
+    attr_rec_t *a = &sim.attrs[sim.num_attrs];
+    memset(a, 0, sizeof(attr_rec_t));
+    a->chip = sim.cur_chip;
+    snprintf(a->name, sizeof(a->name), "%s", name);
+    a->def_u = default_value;
+    a->def_f = default_value;
+    attr_load(a);
+    return sim.num_attrs++;
+}
+
+uint32_t attr_init_float(const char *name, float default_value) {
+    uint32_t id = attr_init(name, 0);
+    attr_rec_t *a = &sim.attrs[id];
+    a->is_float = true;
+    a->def_f = default_value;
+    a->def_u = (uint32_t)default_value;
+    attr_load(a);
+    return id;
+}
+
+uint32_t attr_read(uint32_t attr_id) {
+    return sim.attrs[attr_id].u;
+}
+
+float attr_read_float(uint32_t attr_id) {
+    return sim.attrs[attr_id].f;
+}
+
+string_t attr_string_init(const char *name) {
+    GROW(sim.strings, sim.num_strings, sim.cap_strings);
+    string_rec_t *s = &sim.strings[sim.num_strings];
+    const chip_attr_t *ca = sim.cur_chip ? chip_attr_find(sim.cur_chip, name) : NULL;
+
+    s->chip = sim.cur_chip;
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->value = strdup(ca ? ca->value : "");
+    return ++sim.num_strings;       // 0 is STRING_NULL
+}
+
+uint32_t string_get_length(string_t string) {
+    return string == STRING_NULL ? 0 : strlen(sim.strings[string - 1].value);
+}
+
+uint32_t string_read(string_t string, char *buf, uint32_t buffer_size) {
+    if (string == STRING_NULL || buffer_size == 0) {
+        return 0;
+    }
+    const char *v = sim.strings[string - 1].value;
+    uint32_t len = strlen(v);
+    if (len >= buffer_size) len = buffer_size - 1;
+    memcpy(buf, v, len);
+    buf[len] = 0;
+    return len;
+}
+
+void sim_chip_attr_set(sim_chip_t *chip, const char *name, const char *value) {
+    sim_chip_attr(chip, name, value);
+    for (uint32_t i = 0; i < sim.num_attrs; i++) {
+        if (sim.attrs[i].chip == chip && !strcmp(sim.attrs[i].name, name)) attr_load(&sim.attrs[i]);
+    }
+    for (uint32_t i = 0; i < sim.num_strings; i++) {
+        string_rec_t *s = &sim.strings[i];
+        if (s->chip == chip && !strcmp(s->name, name)) {
+            free(s->value);
+            s->value = strdup(value);
+        }
+    }
+}
+
+// ==================== uart =========================
+
+void sim_uart_sink_set(sim_uart_sink sink, void *user_data) {
+    sim.uart_sink = sink;
+    sim.uart_sink_data = user_data;
+}
+
+static void uart_done(void *arg, uint32_t data) {
+    uart_rec_t *u = &sim.uarts[(uint32_t)(uintptr_t)arg];
+    u->busy = false;
+    if (u->cfg.write_done) {
+        u->cfg.write_done(u->cfg.user_data);
+    }
+}
+
+uart_dev_t uart_init(const uart_config_t *config) {
+    GROW(sim.uarts, sim.num_uarts, sim.cap_uarts);
+    uart_rec_t *u = &sim.uarts[sim.num_uarts];
+    u->cfg = *config;
+    u->chip = sim.cur_chip;
+    u->busy = false;
+    return sim.num_uarts++;
+}
+
+bool uart_write(uart_dev_t uart, uint8_t *buffer, uint32_t count) {
+    uart_rec_t *u = &sim.uarts[uart];
+    if (u->busy || u->cfg.baud_rate == 0) {
+        return false;
+    }
+    if (sim.uart_sink) {
+        sim.uart_sink(sim.uart_sink_data, u->chip, buffer, count);
+    }
+    // 8N1, 10 bit times per byte
+    u->busy = true;
+    sim_at(sim.now + (uint64_t)count * 10 * 1000000000ull / u->cfg.baud_rate, uart_done, (void *)(uintptr_t)uart, 0);
+    return true;
+}
@@ -0,0 +1,95 @@
+//
+// Native host stand-in for the Wokwi simulator - a discrete event kernel with a virtual clock that
+// implements the wokwi-api.h imports the chip uses (pins, timers, attributes, strings, uart), so
+// the chip sources can be built and profiled natively.
+//
+// Pins are grouped into nets. A net is wired-AND: it is low while any pin on it drives low, high
+// otherwise if something pulls it up (an INPUT_PULLUP pin, an OUTPUT pin driving high, or the net's
+// own pull-up), low when floating. Pin watches are called synchronously when a net changes level,
+// including for the change caused by the watching pin itself, as the chip expects.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_SIM_H
+#define WOKWI_DS1820_CUSTOM_CHIP_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "wokwi-api.h"
+
+typedef void (*sim_fn)(void *arg, uint32_t data);
+
+typedef int32_t sim_net_t;
+#define SIM_NO_NET  ((sim_net_t)-1)
+
+typedef struct sim_chip sim_chip_t;
+
+// kernel
+void sim_reset(void);
+uint64_t sim_now(void);
+// run fn(arg, data) at the given absolute time, events at the same time run in scheduling order
+void sim_at(uint64_t time_ns, sim_fn fn, void *arg, uint32_t data);
+// process events up to and including time_ns, the clock is left at time_ns
+void sim_run_until(uint64_t time_ns);
+// process events until the queue is empty
+void sim_run(void);
+uint64_t sim_events(void);          // events and timer expiries processed so far, stale heap timer events included
+// timers go on a hierarchical timing wheel (twheel.h) with O(1) start and stop. With on, they are
+// heap events like sim_at's and a stop leaves the stale event in the heap, for comparison. Set it
+// before any timer is started; the callbacks run in the same order either way
+void sim_timer_heap(bool on);
+
+// nets
+sim_net_t sim_net_new(const char *name);
+sim_net_t sim_net_find(const char *name);
+const char *sim_net_name(sim_net_t net);
+void sim_net_pullup(sim_net_t net, bool on);
+// force a net to a level (supply and ground nets), -1 releases it
+void sim_net_force(sim_net_t net, int level);
+void sim_net_set_voltage(sim_net_t net, float v);
+uint32_t sim_net_level(sim_net_t net);
+// pins driving the net low
+uint32_t sim_net_drivers(sim_net_t net);
+// fn(user, drivers) is called whenever the number of pins driving the net low changes, before the
+// watches see the new level. One probe per net, NULL removes it
+typedef void (*sim_net_probe_fn)(void *user, uint32_t drivers);
+void sim_net_probe(sim_net_t net, sim_net_probe_fn fn, void *user);
+
+// a pin on a net that belongs to the host rather than a chip, e.g. a bus master. Use the regular
+// pin_* calls on it
+pin_t sim_pin_new(sim_net_t net, const char *name, uint32_t mode);
+
+// chips - a chip instance is a part id, its attributes and a pin name to net binding
+sim_chip_t *sim_chip_new(const char *id);
+void sim_chip_attr(sim_chip_t *chip, const char *name, const char *value);
+// "name=value" as given on a command line, returns -1 if it's malformed
+int sim_chip_attr_arg(sim_chip_t *chip, const char *assignment);
+void sim_chip_bind(sim_chip_t *chip, const char *pin_name, sim_net_t net);
+// net a chip pin is bound to, SIM_NO_NET if it's not connected
+sim_net_t sim_chip_net(const sim_chip_t *chip, const char *pin_name);
+// make chip the target of pin_init/attr_init and call fn, e.g. chip_init
+void sim_chip_call(sim_chip_t *chip, void (*fn)(void));
+// change an attribute of an instantiated chip, like moving a control in the simulator
+void sim_chip_attr_set(sim_chip_t *chip, const char *name, const char *value);
+const char *sim_chip_id(const sim_chip_t *chip);
+
+// uart output of the chips goes here, the default discards it
+typedef void (*sim_uart_sink)(void *user_data, const sim_chip_t *chip, const uint8_t *buf, uint32_t count);
+void sim_uart_sink_set(sim_uart_sink sink, void *user_data);
+
+// load the parts of the given type and the nets from a diagram.json. Supply pins (5V, 3.3V, VCC)
+// of other parts force their net high, GND pins force it low. Returns the number of chips or -1
+int sim_load_diagram(const char *path, const char *chip_type, sim_chip_t **chips, int max_chips);
+
+// wall clock seconds for the throughput the harnesses report, inline so the tools that don't link
+// the kernel can use it too
+static inline double sim_wall_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_SIM_H
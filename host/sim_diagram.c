@@ -0,0 +1,121 @@
+// Native host stand-in - chips and nets from a diagram.json
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "json.h"
+
+#define MAX_ENDPOINTS   256
+
+// connected endpoints ("part:pin") are merged with a union-find, each set becomes a net
+typedef struct {
+    char *name[MAX_ENDPOINTS];
+    int parent[MAX_ENDPOINTS];
+    sim_net_t net[MAX_ENDPOINTS];
+    int len;
+} endpoints_t;
+
+static int ep_find(endpoints_t *ep, int i) {
+    while (ep->parent[i] != i) {
+        ep->parent[i] = ep->parent[ep->parent[i]];
+        i = ep->parent[i];
+    }
+    return i;
+}
+
+static int ep_add(endpoints_t *ep, const char *name) {
+    for (int i = 0; i < ep->len; i++) {
+        if (!strcmp(ep->name[i], name)) return i;
+    }
+    if (ep->len == MAX_ENDPOINTS) {
+        fprintf(stderr, "sim: too many connections\n");
+        return -1;
+    }
+    ep->name[ep->len] = strdup(name);
+    ep->parent[ep->len] = ep->len;
+    ep->net[ep->len] = SIM_NO_NET;
+    return ep->len++;
+}
+
+// supply and ground pins of parts that are not simulated here hold their net
+static int supply_level(const char *endpoint) {
+    const char *pin = strchr(endpoint, ':');
+    pin = pin ? pin + 1 : endpoint;
+    if (!strncmp(pin, "GND", 3)) return LOW;
+    if (!strcmp(pin, "5V") || !strcmp(pin, "3.3V") || !strcmp(pin, "VCC") || !strcmp(pin, "VIN")) return HIGH;
+    return -1;
+}
+
+// bind the endpoint to the chip it belongs to, returns false if it's not a chip pin
+static bool bind_chip_endpoint(const char *endpoint, sim_net_t net, sim_chip_t **chips, int n) {
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(sim_chip_id(chips[i]));
+        if (!strncmp(endpoint, sim_chip_id(chips[i]), len) && endpoint[len] == ':') {
+            sim_chip_bind(chips[i], endpoint + len + 1, net);
+            return true;
+        }
+    }
+    return false;
+}
+
+int sim_load_diagram(const char *path, const char *chip_type, sim_chip_t **chips, int max_chips) {
+    json_t *d = json_load(path);
+    if (d == NULL) {
+        return -1;
+    }
+
+    int n = 0;
+    json_t *parts = json_get(d, "parts");
+    for (json_t *p = parts ? parts->child : NULL; p; p = p->next) {
+        json_t *type = json_get(p, "type");
+        json_t *id = json_get(p, "id");
+        if (type == NULL || id == NULL || type->type != JSON_STR || strcmp(type->str, chip_type)) continue;
+        if (n == max_chips) {
+            fprintf(stderr, "sim: more than %d %s parts, ignoring the rest\n", max_chips, chip_type);
+            break;
+        }
+        sim_chip_t *chip = sim_chip_new(id->str);
+        json_t *attrs = json_get(p, "attrs");
+        for (json_t *a = attrs ? attrs->child : NULL; a; a = a->next) {
+            char buf[32];
+            const char *v = json_text(a, buf, sizeof(buf));
+            if (v) sim_chip_attr(chip, a->key, v);
+        }
+        chips[n++] = chip;
+    }
+
+    endpoints_t *ep = calloc(1, sizeof(endpoints_t));
+    json_t *conns = json_get(d, "connections");
+    for (json_t *c = conns ? conns->child : NULL; c; c = c->next) {
+        json_t *a = c->child;
+        json_t *b = a ? a->next : NULL;
+        if (b == NULL || a->type != JSON_STR || b->type != JSON_STR) continue;
+        int ia = ep_add(ep, a->str);
+        int ib = ep_add(ep, b->str);
+        if (ia < 0 || ib < 0) continue;
+        ep->parent[ep_find(ep, ia)] = ep_find(ep, ib);
+    }
+
+    // a net per set, named after its first endpoint
+    for (int i = 0; i < ep->len; i++) {
+        int root = ep_find(ep, i);
+        if (ep->net[root] == SIM_NO_NET) {
+            ep->net[root] = sim_net_new(ep->name[i]);
+        }
+        sim_net_t net = ep->net[root];
+
+        if (!bind_chip_endpoint(ep->name[i], net, chips, n) && supply_level(ep->name[i]) >= 0) {
+            sim_net_force(net, supply_level(ep->name[i]));
+        }
+    }
+
+    for (int i = 0; i < ep->len; i++) free(ep->name[i]);
+    free(ep);
+    json_free(d);
+    return n;
+}
@@ -0,0 +1,387 @@
+// sigrok session (.sr) reader - a zip archive with a `metadata` ini and the logic samples split in
+// chunk files (`logic-1-1`, `logic-1-2`, ...), unitsize bytes per sample with probe n in bit n - 1.
+// Chunks are inflated one at a time and scanned for changes in bulk, 8 samples per compare when
+// a sample is a byte.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <zlib.h>
+
+#include "vcd.h"
+
+#define ZIP_EOCD_SIG        0x06054b50
+#define ZIP_CDIR_SIG        0x02014b50
+#define ZIP_LOCAL_SIG       0x04034b50
+#define ZIP_STORED          0
+#define ZIP_DEFLATED        8
+#define ZIP_NAME_LEN        64
+#define ZIP_IO_LEN          65536
+#define ZIP_MAX_RATIO       1032    // deflate can't do better than this
+
+typedef struct {
+    char name[ZIP_NAME_LEN];
+    uint32_t method;
+    uint32_t csize, usize;
+    uint32_t offset;        // local header
+    long seq;               // chunk number, 0 for a single capture file
+} zip_entry_t;
+
+struct sr_session {
+    FILE *f;
+    long size;              // of the file, every zip offset and size is checked against it
+    zip_entry_t *entries;
+    size_t num_entries;
+    zip_entry_t **chunks;   // sample chunks in order
+    size_t num_chunks, next_chunk;
+
+    uint64_t rate;          // samples per second
+    uint32_t unitsize;
+    uint64_t mask;          // probe bits followed
+    int probe[VCD_MAX_WIRES];
+
+    uint8_t *buf;           // current chunk, inflated
+    size_t num_samples, cap;
+    size_t pos;             // next sample to scan in buf
+    uint64_t base;          // sample number of buf[0]
+    uint64_t sample;        // last sample, masked
+    uint64_t pending;       // wires that changed with it and were not returned yet
+    uint64_t at;            // sample number of the last change
+    int started;
+};
+
+static uint32_t get16(const uint8_t *p) { return p[0] | p[1] << 8; }
+static uint32_t get32(const uint8_t *p) { return get16(p) | (uint32_t)get16(p + 2) << 16; }
+
+// ==================== zip =========================
+
+static int zip_read_dir(sr_session_t *s, const char *path) {
+    uint8_t tail[65536 + 22];
+
+    fseek(s->f, 0, SEEK_END);
+    long size = s->size = ftell(s->f);
+    long n = size < (long)sizeof(tail) ? size : (long)sizeof(tail);
+    fseek(s->f, size - n, SEEK_SET);
+    if (fread(tail, 1, n, s->f) != (size_t)n) {
+        return -1;
+    }
+
+    // the end of central directory record, behind it only its comment
+    long eocd = -1;
+    for (long i = n - 22; i >= 0; i--) {
+        if (get32(tail + i) == ZIP_EOCD_SIG) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0) {
+        fprintf(stderr, "%s: not a zip archive\n", path);
+        return -1;
+    }
+    uint32_t count = get16(tail + eocd + 10);
+    uint32_t dir_size = get32(tail + eocd + 12);
+    uint32_t dir_offset = get32(tail + eocd + 16);
+    if (count == 0xFFFF || dir_offset == 0xFFFFFFFF) {
+        fprintf(stderr, "%s: zip64 archives are not supported\n", path);
+        return -1;
+    }
+    if ((uint64_t)dir_offset + dir_size > (uint64_t)size) {
+        fprintf(stderr, "%s: zip central directory is past the end of the file\n", path);
+        return -1;
+    }
+
+    uint8_t *dir = malloc(dir_size);
+    s->entries = calloc(count, sizeof(zip_entry_t));
+    if (dir == NULL || s->entries == NULL || fseek(s->f, dir_offset, SEEK_SET) ||
+        fread(dir, 1, dir_size, s->f) != dir_size) {
+        free(dir);
+        return -1;
+    }
+    size_t off = 0;
+    for (uint32_t i = 0; i < count && off + 46 <= dir_size; i++) {
+        const uint8_t *e = dir + off;
+        if (get32(e) != ZIP_CDIR_SIG) break;
+        uint32_t name_len = get16(e + 28);
+        size_t len = 46 + name_len + get16(e + 30) + get16(e + 32);
+        if (off + len > dir_size) {
+            break;
+        }
+        zip_entry_t *z = &s->entries[s->num_entries++];
+        z->method = get16(e + 10);
+        z->csize = get32(e + 20);
+        z->usize = get32(e + 24);
+        z->offset = get32(e + 42);
+        snprintf(z->name, sizeof(z->name), "%.*s", (int)(name_len < ZIP_NAME_LEN ? name_len : ZIP_NAME_LEN - 1),
+                 (const char *)e + 46);
+        // the data follows a local header of at least 30 bytes, and can't inflate to more than
+        // the deflate limit allows
+        if ((uint64_t)z->offset + 30 + z->csize > (uint64_t)size ||
+            (z->method == ZIP_STORED && z->csize != z->usize) ||
+            (uint64_t)z->usize > (uint64_t)z->csize * ZIP_MAX_RATIO + 64) {
+            fprintf(stderr, "%s: bad zip entry %s\n", path, z->name);
+            free(dir);
+            return -1;
+        }
+        off += len;
+    }
+    free(dir);
+    if (s->num_entries < count) {
+        fprintf(stderr, "%s: truncated zip central directory\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static zip_entry_t *zip_find(sr_session_t *s, const char *name) {
+    for (size_t i = 0; i < s->num_entries; i++) {
+        if (!strcmp(s->entries[i].name, name)) return &s->entries[i];
+    }
+    return NULL;
+}
+
+// inflate an entry into *buf, growing it as needed. Returns the length or -1
+static long zip_extract(sr_session_t *s, const zip_entry_t *z, uint8_t **buf, size_t *cap) {
+    uint8_t local[30];
+    if (fseek(s->f, z->offset, SEEK_SET) || fread(local, 1, 30, s->f) != 30 || get32(local) != ZIP_LOCAL_SIG) {
+        fprintf(stderr, "sr: bad zip entry %s\n", z->name);
+        return -1;
+    }
+    if (fseek(s->f, get16(local + 26) + get16(local + 28), SEEK_CUR) ||
+        ftell(s->f) + (long)z->csize > s->size) {
+        fprintf(stderr, "sr: zip entry %s is past the end of the file\n", z->name);
+        return -1;
+    }
+
+    if (*cap < (size_t)z->usize + 8) {
+        // slack for the 8 byte wide scan
+        *cap = (size_t)z->usize + 8;
+        *buf = realloc(*buf, *cap);
+        if (*buf == NULL) return -1;
+    }
+    if (z->method == ZIP_STORED) {
+        return fread(*buf, 1, z->usize, s->f) == z->usize ? (long)z->usize : -1;
+    }
+    if (z->method != ZIP_DEFLATED) {
+        fprintf(stderr, "sr: %s uses zip method %u\n", z->name, z->method);
+        return -1;
+    }
+
+    z_stream zs = {0};
+    uint8_t in[ZIP_IO_LEN];
+    uint32_t left = z->csize;
+    int ret = Z_OK;
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        return -1;
+    }
+    zs.next_out = *buf;
+    zs.avail_out = z->usize;
+    while (ret == Z_OK && left > 0) {
+        uint32_t n = left < sizeof(in) ? left : sizeof(in);
+        if (fread(in, 1, n, s->f) != n) break;
+        left -= n;
+        zs.next_in = in;
+        zs.avail_in = n;
+        while (ret == Z_OK && zs.avail_in > 0 && zs.avail_out > 0) ret = inflate(&zs, Z_NO_FLUSH);
+    }
+    long len = zs.total_out;
+    inflateEnd(&zs);
+    return ret == Z_STREAM_END || (ret == Z_OK && len == (long)z->usize) ? len : -1;
+}
+
+// ==================== metadata =========================
+
+static uint64_t parse_rate(const char *v) {
+    static const struct { const char *unit; uint64_t mult; } units[] = {
+            {"GHz", 1000000000ull}, {"MHz", 1000000}, {"kHz", 1000}, {"Hz", 1},
+    };
+    char *unit;
+    double rate = strtod(v, &unit);
+    while (isspace((unsigned char)*unit)) unit++;
+    for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+        if (!strncmp(unit, units[i].unit, strlen(units[i].unit))) return (uint64_t)(rate * units[i].mult);
+    }
+    return (uint64_t)rate;
+}
+
+static int compare_chunks(const void *a, const void *b) {
+    long sa = (*(zip_entry_t *const *)a)->seq;
+    long sb = (*(zip_entry_t *const *)b)->seq;
+    return (sa > sb) - (sa < sb);
+}
+
+// the first device of the metadata, its probes and sample chunks
+static int read_metadata(sr_session_t *s, vcd_reader_t *r, const char *path, const char *wire) {
+    zip_entry_t *meta = zip_find(s, "metadata");
+    uint8_t *text = NULL;
+    size_t cap = 0;
+    long len;
+    if (meta == NULL || (len = zip_extract(s, meta, &text, &cap)) < 0) {
+        fprintf(stderr, "%s: no sigrok metadata\n", path);
+        free(text);
+        return -1;
+    }
+    text[len] = 0;
+
+    char capturefile[ZIP_NAME_LEN] = "logic-1";
+    int device = 0;
+    s->unitsize = 1;
+    for (char *line = strtok((char *)text, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+        if (line[0] == '[') {
+            device = !strncmp(line, "[device ", 8) ? device + 1 : device;
+            continue;
+        }
+        char *eq = strchr(line, '=');
+        if (eq == NULL || device != 1) continue;
+        *eq = 0;
+        const char *key = line, *value = eq + 1;
+        if (!strcmp(key, "capturefile")) {
+            snprintf(capturefile, sizeof(capturefile), "%s", value);
+        } else if (!strcmp(key, "samplerate")) {
+            s->rate = parse_rate(value);
+        } else if (!strcmp(key, "unitsize")) {
+            s->unitsize = atoi(value);
+        } else if (!strncmp(key, "probe", 5) && isdigit((unsigned char)key[5])) {
+            int probe = atoi(key + 5) - 1;
+            if (probe < 0 || probe >= 64 || (wire && strcmp(value, wire)) || r->num_wires == VCD_MAX_WIRES) continue;
+            vcd_wire_t *w = &r->wires[r->num_wires];
+            snprintf(w->id, sizeof(w->id), "%d", probe + 1);
+            snprintf(w->name, sizeof(w->name), "%s", value);
+            w->value = -1;
+            s->probe[r->num_wires++] = probe;
+            s->mask |= 1ull << probe;
+        }
+    }
+    free(text);
+    if (s->rate == 0 || s->unitsize < 1 || s->unitsize > 8) {
+        fprintf(stderr, "%s: unsupported samplerate or unitsize\n", path);
+        return -1;
+    }
+    if (r->num_wires == 0) {
+        fprintf(stderr, "%s: no probe named %s\n", path, wire ? wire : "");
+        return -1;
+    }
+
+    // capturefile alone (old sessions) or capturefile-1, capturefile-2, ...
+    size_t n = strlen(capturefile);
+    s->chunks = calloc(s->num_entries, sizeof(zip_entry_t *));
+    for (size_t i = 0; s->chunks && i < s->num_entries; i++) {
+        zip_entry_t *z = &s->entries[i];
+        if (strncmp(z->name, capturefile, n)) continue;
+        if (z->name[n] == 0) z->seq = 0;
+        else if (z->name[n] == '-' && isdigit((unsigned char)z->name[n + 1])) z->seq = atol(z->name + n + 1);
+        else continue;
+        s->chunks[s->num_chunks++] = z;
+    }
+    qsort(s->chunks, s->num_chunks, sizeof(zip_entry_t *), compare_chunks);
+    return 0;
+}
+
+// ==================== samples =========================
+
+static inline uint64_t sample_at(const sr_session_t *s, size_t i) {
+    if (s->unitsize == 1) {
+        return s->buf[i];
+    }
+    uint64_t v = 0;
+    memcpy(&v, s->buf + i * s->unitsize, s->unitsize);
+    return v;
+}
+
+// first sample from i on that differs from the last one in the followed probes, num_samples if none
+static size_t scan(const sr_session_t *s, size_t i) {
+    size_t n = s->num_samples;
+
+    if (s->unitsize == 1) {
+        const uint64_t ones = 0x0101010101010101ull;
+        uint64_t prev = (s->sample & 0xFF) * ones;
+        uint64_t mask = (s->mask & 0xFF) * ones;
+        for (; i + 8 <= n; i += 8) {
+            uint64_t w;
+            memcpy(&w, s->buf + i, 8);
+            uint64_t x = (w ^ prev) & mask;
+            if (x) return i + __builtin_ctzll(x) / 8;
+        }
+    }
+    for (; i < n; i++) {
+        if ((sample_at(s, i) ^ s->sample) & s->mask) return i;
+    }
+    return n;
+}
+
+static int next_chunk(sr_session_t *s) {
+    if (s->next_chunk == s->num_chunks) {
+        return 0;
+    }
+    s->base += s->num_samples;
+    long len = zip_extract(s, s->chunks[s->next_chunk++], &s->buf, &s->cap);
+    if (len < 0) {
+        fprintf(stderr, "sr: failed to read sample chunk %zu\n", s->next_chunk);
+        return 0;
+    }
+    s->num_samples = len / s->unitsize;
+    s->pos = 0;
+    return 1;
+}
+
+sr_session_t *sr_open(vcd_reader_t *r, const char *path, const char *wire) {
+    sr_session_t *s = calloc(1, sizeof(sr_session_t));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->f = fopen(path, "rb");
+    if (s->f == NULL) {
+        perror(path);
+        free(s);
+        return NULL;
+    }
+    if (zip_read_dir(s, path) < 0 || read_metadata(s, r, path, wire) < 0) {
+        sr_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+int sr_next(sr_session_t *s, vcd_reader_t *r, uint64_t *time_ns, int *wire, int *value) {
+    while (s->pending == 0) {
+        size_t i = s->pos < s->num_samples ? scan(s, s->pos) : s->num_samples;
+        if (i == s->num_samples) {
+            if (!next_chunk(s)) return 0;
+            if (s->started) continue;
+            i = 0;
+        }
+        uint64_t sample = sample_at(s, i) & s->mask;
+        uint64_t changed = s->started ? sample ^ s->sample : s->mask;
+        s->started = 1;
+        s->sample = sample;
+        s->pos = i + 1;
+        s->at = s->base + i;
+        for (int w = 0; w < r->num_wires; w++) {
+            if (changed >> s->probe[w] & 1) s->pending |= 1ull << w;
+        }
+    }
+
+    int w = __builtin_ctzll(s->pending);
+    s->pending &= s->pending - 1;
+    r->wires[w].value = s->sample >> s->probe[w] & 1;
+    r->time = s->at / s->rate * 1000000000ull + s->at % s->rate * 1000000000ull / s->rate;
+    r->changes++;
+    *time_ns = r->time;
+    *wire = w;
+    *value = r->wires[w].value;
+    return 1;
+}
+
+void sr_close(sr_session_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    if (s->f) fclose(s->f);
+    free(s->entries);
+    free(s->chunks);
+    free(s->buf);
+    free(s);
+}
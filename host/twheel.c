@@ -0,0 +1,161 @@
+// Hierarchical timing wheel for the host timers
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "twheel.h"
+
+void tw_init(twheel_t *tw) {
+    memset(tw, 0, sizeof(twheel_t));
+    memset(tw->head, 0xFF, sizeof(tw->head));
+}
+
+void tw_free(twheel_t *tw) {
+    free(tw->nodes);
+    tw_init(tw);
+}
+
+uint32_t tw_node_new(twheel_t *tw) {
+    if (tw->num_nodes >= tw->cap_nodes) {
+        tw->cap_nodes = tw->cap_nodes ? tw->cap_nodes * 2 : 64;
+        tw->nodes = realloc(tw->nodes, tw->cap_nodes * sizeof(tw_node_t));
+        if (tw->nodes == NULL) {
+            fprintf(stderr, "twheel: out of memory\n");
+            exit(1);
+        }
+    }
+    memset(&tw->nodes[tw->num_nodes], 0, sizeof(tw_node_t));
+    return tw->num_nodes++;
+}
+
+// the highest byte in which time differs from the cursor
+static inline uint8_t level_of(const twheel_t *tw, uint64_t time) {
+    uint64_t x = time ^ tw->now;
+    return x < TW_SLOTS ? 0 : (63 - __builtin_clzll(x)) / TW_BITS;
+}
+
+// link before the node at, or as the only node of the slot
+static void link_before(twheel_t *tw, uint32_t id, uint32_t at, uint32_t *head) {
+    tw_node_t *n = &tw->nodes[id];
+    if (at == TW_NIL) {
+        n->next = n->prev = id;
+        *head = id;
+        return;
+    }
+    tw_node_t *a = &tw->nodes[at];
+    n->next = at;
+    n->prev = a->prev;
+    tw->nodes[a->prev].next = id;
+    a->prev = id;
+}
+
+static void put(twheel_t *tw, uint32_t id) {
+    tw_node_t *n = &tw->nodes[id];
+    uint8_t level = level_of(tw, n->time);
+    uint8_t slot = n->time >> (level * TW_BITS) & (TW_SLOTS - 1);
+    uint32_t *head = &tw->head[level][slot];
+    n->level = level;
+    n->slot = slot;
+    n->linked = true;
+    tw->used[level][slot / 64] |= 1ull << (slot % 64);
+
+    // level 0 nodes all expire at the same time, keep them by sequence. Nodes are mostly added in
+    // sequence order so the walk from the tail is short
+    uint32_t at = *head;
+    if (level == 0 && at != TW_NIL) {
+        uint32_t tail = tw->nodes[at].prev;
+        while (tw->nodes[tail].seq > n->seq) {
+            if (tail == at) {
+                link_before(tw, id, at, head);
+                *head = id;
+                return;
+            }
+            tail = tw->nodes[tail].prev;
+        }
+        at = tw->nodes[tail].next;
+    }
+    link_before(tw, id, at, head);
+}
+
+void tw_add(twheel_t *tw, uint32_t id, uint64_t time, uint64_t seq) {
+    tw_node_t *n = &tw->nodes[id];
+    n->time = time < tw->now ? tw->now : time;
+    n->seq = seq;
+    put(tw, id);
+    tw->count++;
+}
+
+static void unlink_node(twheel_t *tw, uint32_t id) {
+    tw_node_t *n = &tw->nodes[id];
+    uint32_t *head = &tw->head[n->level][n->slot];
+    if (n->next == id) {
+        *head = TW_NIL;
+        tw->used[n->level][n->slot / 64] &= ~(1ull << (n->slot % 64));
+    } else {
+        tw->nodes[n->prev].next = n->next;
+        tw->nodes[n->next].prev = n->prev;
+        if (*head == id) *head = n->next;
+    }
+    n->linked = false;
+}
+
+void tw_del(twheel_t *tw, uint32_t id) {
+    if (tw->nodes[id].linked) {
+        unlink_node(tw, id);
+        tw->count--;
+    }
+}
+
+// first occupied slot at or after from, -1 if none
+static int next_used(const uint64_t *used, uint32_t from) {
+    for (uint32_t w = from / 64; w < TW_SLOTS / 64; w++) {
+        uint64_t bits = used[w];
+        if (w == from / 64) bits &= ~0ull << (from % 64);
+        if (bits) return w * 64 + __builtin_ctzll(bits);
+    }
+    return -1;
+}
+
+uint32_t tw_first(twheel_t *tw, uint64_t bound) {
+    while (tw->count > 0) {
+        // slots before the cursor's are empty on every level, and everything on a level expires
+        // before anything on the levels above it
+        uint8_t level = 0;
+        int slot = -1;
+        for (; level < TW_LEVELS; level++) {
+            slot = next_used(tw->used[level], tw->now >> (level * TW_BITS) & (TW_SLOTS - 1));
+            if (slot >= 0) break;
+        }
+        if (slot < 0) {
+            return TW_NIL;
+        }
+
+        uint32_t shift = level * TW_BITS;
+        uint64_t high = shift + TW_BITS < 64 ? tw->now >> (shift + TW_BITS) << (shift + TW_BITS) : 0;
+        uint64_t start = high | (uint64_t)slot << shift;
+        if (start > bound) {
+            return TW_NIL;
+        }
+        if (level == 0) {
+            tw->now = start;
+            return tw->head[0][slot];
+        }
+
+        // move into the slot and spread its nodes over the levels below
+        uint32_t id = tw->head[level][slot];
+        tw->head[level][slot] = TW_NIL;
+        tw->used[level][slot / 64] &= ~(1ull << (slot % 64));
+        tw->now = start;
+        tw->nodes[tw->nodes[id].prev].next = TW_NIL;
+        while (id != TW_NIL) {
+            uint32_t next = tw->nodes[id].next;
+            put(tw, id);
+            id = next;
+        }
+    }
+    return TW_NIL;
+}
@@ -0,0 +1,65 @@
+//
+// Hierarchical timing wheel with ns resolution for the host timers - 8 levels of 256 slots, one
+// per byte of the 64 bit expiry time. A node goes on the level of the highest byte in which its
+// expiry differs from the wheel's cursor, in the slot of that byte, so add and remove are O(1)
+// list operations. Level 0 slots hold a single expiry time each and are kept in sequence order, so
+// timers due at the same time come out in the order they were started.
+//
+// Finding the next expiry looks at the first occupied slot at or after the cursor on the lowest
+// occupied level, through a bitmap per level. When that is above level 0 the cursor moves to the
+// start of the slot and its nodes are spread over the levels below, each node moves down at most
+// 7 times over its life.
+//
+// Nodes are referred to by index, the wheel owns the node array so it can grow.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_TWHEEL_H
+#define WOKWI_DS1820_CUSTOM_CHIP_TWHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TW_BITS     8
+#define TW_SLOTS    (1 << TW_BITS)
+#define TW_LEVELS   (64 / TW_BITS)
+#define TW_NIL      UINT32_MAX
+
+typedef struct {
+    uint64_t time;
+    uint64_t seq;
+    uint32_t next, prev;        // circular list of the slot
+    uint8_t level;
+    uint8_t slot;
+    bool linked;
+} tw_node_t;
+
+typedef struct {
+    uint64_t now;               // cursor, no node expires before it
+    uint32_t count;             // nodes on the wheel
+    uint32_t head[TW_LEVELS][TW_SLOTS];
+    uint64_t used[TW_LEVELS][TW_SLOTS / 64];
+    tw_node_t *nodes;
+    uint32_t num_nodes, cap_nodes;
+} twheel_t;
+
+void tw_init(twheel_t *tw);
+void tw_free(twheel_t *tw);
+// a new unlinked node, returns its index
+uint32_t tw_node_new(twheel_t *tw);
+// link a node to expire at time, times before the cursor are taken as the cursor. The node must
+// not be linked already
+void tw_add(twheel_t *tw, uint32_t id, uint64_t time, uint64_t seq);
+// unlink a node if it's linked
+void tw_del(twheel_t *tw, uint32_t id);
+// the node that expires first, if it expires no later than bound. Moves the cursor up to at most
+// bound, so the caller must not add nodes before bound afterwards
+uint32_t tw_first(twheel_t *tw, uint64_t bound);
+
+static inline tw_node_t *tw_node(twheel_t *tw, uint32_t id) {
+    return &tw->nodes[id];
+}
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_TWHEEL_H
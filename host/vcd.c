@@ -0,0 +1,165 @@
+// Streaming VCD reader - whitespace separated tokens, one pass
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "vcd.h"
+
+#define TOKEN_LEN   128
+
+static int next_token(FILE *f, char *tok) {
+    int c;
+    int n = 0;
+
+    while ((c = getc_unlocked(f)) != EOF && isspace(c));
+    while (c != EOF && !isspace(c)) {
+        if (n < TOKEN_LEN - 1) tok[n++] = c;
+        c = getc_unlocked(f);
+    }
+    tok[n] = 0;
+    return n;
+}
+
+// skip to the $end of the current declaration
+static void skip_decl(FILE *f) {
+    char tok[TOKEN_LEN];
+    while (next_token(f, tok) && strcmp(tok, "$end"));
+}
+
+static uint64_t parse_timescale(FILE *f) {
+    static const struct { const char *unit; uint64_t ps; } units[] = {
+            {"s", 1000000000000ull}, {"ms", 1000000000ull}, {"us", 1000000ull}, {"ns", 1000}, {"ps", 1},
+    };
+    char tok[TOKEN_LEN], spec[TOKEN_LEN] = {0};
+
+    // "1ns" or "1 ns"
+    while (next_token(f, tok) && strcmp(tok, "$end")) {
+        strncat(spec, tok, sizeof(spec) - strlen(spec) - 1);
+    }
+    char *unit;
+    uint64_t mult = strtoull(spec, &unit, 10);
+    for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+        if (!strcmp(unit, units[i].unit)) return mult * units[i].ps;
+    }
+    fprintf(stderr, "vcd: unsupported timescale '%s', assuming 1ns\n", spec);
+    return 1000;
+}
+
+int vcd_open(vcd_reader_t *r, const char *path, const char *wire) {
+    char tok[TOKEN_LEN];
+
+    memset(r, 0, sizeof(vcd_reader_t));
+    r->scale = 1000;
+    r->f = fopen(path, "r");
+    if (r->f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char sig[4] = {0};
+    if (fread(sig, 1, sizeof(sig), r->f) == sizeof(sig) && !memcmp(sig, "PK\3\4", 4)) {
+        fclose(r->f);
+        r->f = NULL;
+        r->sr = sr_open(r, path, wire);
+        return r->sr ? 0 : -1;
+    }
+    rewind(r->f);
+
+    while (next_token(r->f, tok)) {
+        if (!strcmp(tok, "$enddefinitions")) {
+            skip_decl(r->f);
+            if (r->num_wires == 0) {
+                fprintf(stderr, "vcd: no wire named %s in %s\n", wire ? wire : "", path);
+                return -1;
+            }
+            return 0;
+        }
+        if (!strcmp(tok, "$timescale")) {
+            r->scale = parse_timescale(r->f);
+        } else if (!strcmp(tok, "$var")) {
+            // $var type size id reference $end
+            char size[TOKEN_LEN], id[TOKEN_LEN], ref[TOKEN_LEN];
+            next_token(r->f, tok);
+            next_token(r->f, size);
+            next_token(r->f, id);
+            next_token(r->f, ref);
+            skip_decl(r->f);
+            if (strcmp(size, "1") || (wire && strcmp(ref, wire))) continue;
+            if (r->num_wires == VCD_MAX_WIRES) {
+                fprintf(stderr, "vcd: more than %d wires, ignoring %s\n", VCD_MAX_WIRES, ref);
+                continue;
+            }
+            vcd_wire_t *w = &r->wires[r->num_wires++];
+            snprintf(w->id, sizeof(w->id), "%.15s", id);
+            snprintf(w->name, sizeof(w->name), "%.15s", ref);
+            w->value = -1;
+        } else if (tok[0] == '$') {
+            // $version, $date, $scope, $upscope, $comment
+            skip_decl(r->f);
+        }
+    }
+    fprintf(stderr, "vcd: %s has no $enddefinitions\n", path);
+    return -1;
+}
+
+static int find_wire(const vcd_reader_t *r, const char *id) {
+    for (int i = 0; i < r->num_wires; i++) {
+        if (!strcmp(r->wires[i].id, id)) return i;
+    }
+    return -1;
+}
+
+int vcd_next(vcd_reader_t *r, uint64_t *time_ns, int *wire, int *value) {
+    char tok[TOKEN_LEN];
+    int i;
+
+    if (r->sr) {
+        return sr_next(r->sr, r, time_ns, wire, value);
+    }
+    while (next_token(r->f, tok)) {
+        switch (tok[0]) {
+            case '#':
+                r->time = strtoull(tok + 1, NULL, 10) * r->scale / 1000;
+                break;
+            case '0':
+            case '1':
+            case 'x':
+            case 'X':
+            case 'z':
+            case 'Z':
+                if ((i = find_wire(r, tok + 1)) < 0) break;
+                // unknown and floating read as high, the bus is pulled up
+                r->wires[i].value = tok[0] != '0';
+                r->changes++;
+                *time_ns = r->time;
+                *wire = i;
+                *value = r->wires[i].value;
+                return 1;
+            case 'b':
+            case 'B':
+            case 'r':
+            case 'R':
+                // vectors and reals, the identifier follows as a separate token
+                next_token(r->f, tok);
+                break;
+            case '$':
+                // $dumpvars and friends wrap value changes, their $end is skipped as a token
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+void vcd_close(vcd_reader_t *r) {
+    if (r->f) fclose(r->f);
+    sr_close(r->sr);
+    r->f = NULL;
+    r->sr = NULL;
+}
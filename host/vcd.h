@@ -0,0 +1,50 @@
+//
+// Streaming VCD reader for the host build - follows the scalar wires of a capture, e.g. the
+// channels of a Wokwi logic analyzer export, without loading the file. sigrok/PulseView sessions
+// (.sr) are recognised by their zip signature and read through the same calls (host/sr.c), their
+// probes show up as wires.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_VCD_H
+#define WOKWI_DS1820_CUSTOM_CHIP_VCD_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define VCD_MAX_WIRES   64
+
+typedef struct vcd_wire {
+    char id[16];            // identifier code
+    char name[16];          // reference name, e.g. D0
+    int value;              // last value, -1 before its first change
+} vcd_wire_t;
+
+typedef struct sr_session sr_session_t;
+
+typedef struct vcd_reader {
+    FILE *f;
+    sr_session_t *sr;       // set for a sigrok session
+    vcd_wire_t wires[VCD_MAX_WIRES];
+    int num_wires;
+    uint64_t scale;         // timescale in ps
+    uint64_t time;          // current timestamp, ns
+    uint64_t changes;       // value changes read so far
+} vcd_reader_t;
+
+// open path and read its header. wire is the $var reference name to follow, e.g. "D0", or NULL for
+// all scalar wires in declaration order. Returns 0 on success
+int vcd_open(vcd_reader_t *r, const char *path, const char *wire);
+// next change of a followed wire, repeated values included. Sets the index of the wire in r->wires.
+// Returns 0 at the end of the file
+int vcd_next(vcd_reader_t *r, uint64_t *time_ns, int *wire, int *value);
+void vcd_close(vcd_reader_t *r);
+
+// sigrok sessions, used by the calls above
+sr_session_t *sr_open(vcd_reader_t *r, const char *path, const char *wire);
+int sr_next(sr_session_t *s, vcd_reader_t *r, uint64_t *time_ns, int *wire, int *value);
+void sr_close(sr_session_t *s);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_VCD_H
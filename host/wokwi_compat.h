@@ -0,0 +1,19 @@
+//
+// Force included (-include) into every translation unit of the native host build.
+//
+// wokwi-api.h names its timer handle timer_t, which clashes with the POSIX type of the same name
+// once any libc header pulls in <sys/types.h>. Pull it in first and rename the Wokwi one.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_WOKWI_COMPAT_H
+#define WOKWI_DS1820_CUSTOM_CHIP_WOKWI_COMPAT_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#define timer_t wokwi_timer_t
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_WOKWI_COMPAT_H
@@ -6,24 +6,40 @@
 #define WOKWI_DS1820_CUSTOM_CHIP_OW_H
 
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "hashmap.h"
-
-#define DEBUG 1
+#include "ow_trace.h"
+#include "ow_stats.h"
+#include "ow_log.h"
+#include "ow_slog.h"
+#include "ow_rec.h"
 
 // --------------- Debug Macros -----------------------
-#ifdef DEBUG
-#ifndef OW_DEBUGF
-#define _DEBUGF(debug, ...)  { if (debug) {printf(__VA_ARGS__);}  }
-#define OW_DEBUGF(...)  _DEBUGF(ctx->owDebug, __VA_ARGS__)
-#endif
+// Log levels. OW_LOG_LEVEL_MAX is the compile time floor, anything above it is constant false and
+// removed by the compiler together with its format string. Release (NDEBUG) builds keep errors
+// and warnings only. What is left is filtered by the runtime level of the context (`logLevel`
+// attribute, raised to LOG_TRACE by `owDebug`/`genDebug`).
+#define LOG_NONE    0
+#define LOG_ERROR   1
+#define LOG_WARN    2
+#define LOG_INFO    3
+#define LOG_TRACE   4
+
+#ifndef OW_LOG_LEVEL_MAX
+#ifdef NDEBUG
+#define OW_LOG_LEVEL_MAX LOG_WARN
 #else
-#ifndef OW_DEBUGF
-#define OW_DEBUGF(...)
+#define OW_LOG_LEVEL_MAX LOG_TRACE
+#endif
 #endif
-#endif //  DEBUG
+
+#define LOG_ON(cur, lvl)        ((lvl) <= OW_LOG_LEVEL_MAX && (lvl) <= (cur))
+#define _LOGF(d, lvl, ...)      { if (LOG_ON((d)->log_level, lvl)) {ow_log_printf((d)->log, __VA_ARGS__);} }
+#define OW_LOGF(lvl, ...)       _LOGF(&ctx->diag, lvl, __VA_ARGS__)
+#define OW_DEBUGF(...)          OW_LOGF(LOG_TRACE, __VA_ARGS__)
 // --------------- Debug Macros -----------------------
 
 #define MICROS_IN_SEC 1000000
@@ -31,8 +47,8 @@
 #define IN_RANGE(x, y, err) ( (y) > (x) ? (y) - (x) <= err : (x) - (y) <= err)
 #define OW_ELAPSED(t) ((get_sim_nanos() - t))
 #define OW_ELAPSED_US(t) (OW_ELAPSED(t) / 1000)
-#define _NS(v) ((uint64_t)v *1000)
-#define _US(v) ((uint64_t)v /1000)
+#define _NS(v) ((uint64_t)(v) * 1000)
+#define _US(v) ((uint64_t)(v) / 1000)
 
 #define TOO_EARLY(t, p, e) (get_sim_nanos() + e < t + p) // - (OW_ELAPSED(t) - p) < e)
 
@@ -76,9 +92,30 @@
 #define PR_DUR_READ_SLOT_END 45
 #define PR_DUR_READ_INIT 1
 
-// allow 2us of jitter
+// allow 2us of jitter (ns)
 #define PR_DUR_BUS_JITTER _NS(2)
 
+// master side limits, only used to flag out of spec timing in the slot histograms
+#define PR_DUR_RESET_MAX 960                // longest reset pulse
+#define PR_DUR_SLOT 60                      // shortest time slot (and write 0 low time)
+#define PR_DUR_SLOT_MAX 120                 // longest write 0 low time
+#define PR_DUR_RECOVERY 1                   // shortest recovery time between slots
+
+
+// rom commands
+#define OW_CMD_SEARCH           0xF0
+#define OW_CMD_READ             0x33
+#define OW_CMD_MATCH            0x55
+#define OW_CMD_SKIP             0xCC
+#define OW_CMD_ALM_SEARCH       0xEC
+
+// function commands (DS18x20)
+#define DS_CMD_CONVERT          0x44
+#define DS_CMD_WR_SCRATCH       0x4E
+#define DS_CMD_RD_SCRATCH       0xBE
+#define DS_CMD_CP_SCRATCH       0x48
+#define DS_CMD_RECALL           0xB8
+#define DS_CMD_RD_PWD           0xB4
 
 #define OW_ERR_NO_ERROR 0x0
 #define OW_ERR_UNEXPECTED_BIT_STATE 0x8000
@@ -157,6 +194,21 @@ typedef enum {
 
 
 typedef struct sm sm_t;
+
+// per chip diagnostics, shared by all the layers of a chip
+typedef struct ow_diag {
+    uint8_t log_level;      // effective level, follows the filter
+    uint8_t base_level;     // level from the attributes
+    ow_filter_t *filter;    // runtime log filter, owned by the chip. NULL if there's none
+    ow_slog_t *slog;        // state log, owned by the chip. May be NULL
+    ow_trace_t *trace;      // flight recorder, owned by the chip. May be NULL
+    ow_stats_t *stats;      // counters, owned by the chip. May be NULL
+    ow_log_t *log;          // log buffer, owned by the chip. NULL logs directly
+} ow_diag_t;
+
+// protocol error: counted, and the flight recorder is dumped by the next state reset
+#define OW_FAULT(d, why)    { OW_STATS_INC((d)->stats, errors); OW_TRACE_FAULT((d)->trace, why); }
+
 typedef void (*sig_cb)(void *user_data, uint32_t err, uint32_t cb_data);
 typedef void (*reset_state)(void *ctx);
 
@@ -178,13 +230,22 @@ typedef struct ow_ctx {
     uint64_t slot_start;
     bool reset_timer_expired;
 
+    // edge times for the master timing histograms
+    uint64_t last_fall;
+    uint64_t last_rise;
+    uint64_t last_slot;     // start of the previous slot, 0 after a reset
+
     sm_t *cur_sm;
 
-    bool owDebug;
+    ow_diag_t diag;
 
-    // configurable timing vars
+    // configurable timing vars, us unless noted
     uint32_t presence_wait_time;
     uint32_t presence_time;
+    uint32_t reset_slot_end;
+    uint32_t sample_wait_time;
+    uint32_t read_hold_time;
+    uint64_t bus_jitter;        // ns
 } ow_ctx_t;
 
 typedef struct {
@@ -194,6 +255,11 @@ typedef struct {
     sig_cb  reset_cb;
     sig_cb  bit_read_cb;
     sig_cb  bit_written_cb;
+    ow_trace_t *trace;
+    ow_stats_t *stats;
+    ow_log_t *log;
+    ow_filter_t *filter;
+    ow_slog_t *slog;
 } ow_ctx_cfg_t;
 
 typedef void (*byte_cb)(void *user_data, uint32_t err, uint32_t cb_data);
@@ -209,7 +275,7 @@ typedef struct ow_byte_ctx {
     ow_ctx_t *ow_ctx;       // signalling context
     reset_state reset_fn;   // used by generic sm to reset state on error
 
-    bool owDebug;
+    ow_diag_t diag;
 } ow_byte_ctx_t;
 
 
@@ -230,18 +296,21 @@ typedef struct sm_cfg {
     const char *name;
     sm_entry_t *sm_entries;
     int num_entries;
+    int stats_base;     // first transition counter, assigned by ow_stats_register
+    int id;             // 1 based id, assigned by ow_stats_register. 0 until registered, -1 if there was no room
 } sm_cfg_t;
 
 typedef HASHMAP(uint64_t, sm_entry_t ) sm_entry_map_t;
 
 
+// one per state machine, shared by every chip instance. The per instance state is in the contexts
 typedef struct sm {
     sm_cfg_t *cfg;
-    const void *hash;
+    const void *hash;       // entry lookup, built on the first dispatch and read only after that
 } sm_t;
 
 // forward decl for sm
-void sm_push_event(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, uint32_t ev, uint32_t ev_data, bool debug);
+void sm_push_event(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, uint32_t ev, uint32_t ev_data, ow_diag_t *diag);
 void sm_init_hash(sm_t *sm);
 uint64_t state_event_to_key(uint32_t state, uint32_t event);
 
@@ -263,6 +332,7 @@ ow_ctx_t * ow_ctx_init(ow_ctx_cfg_t *cfg);
 void ow_ctx_reset_state(ow_ctx_t *ctx);
 void ow_ctx_set_master_write_state(ow_ctx_t *ctx, bool bit);
 void ow_ctx_set_master_read_state(ow_ctx_t *ctx, bool bit);
+uint8_t ow_log_level_init(const char *trace_attr);
 
 void on_not_impl(void *chip, uint32_t data);
 
@@ -0,0 +1,34 @@
+//
+// Dallas/Maxim 1-Wire CRC helpers, shared by the chip and the host side tools.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_CRC_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_CRC_H
+
+#include <stdint.h>
+
+// Dow-CRC8 using polynomial X^8 + X^5 + X^4 + X^0 (reflected 0x8C)
+#define OW_CRC8_POLY    0x8C
+// Dow-CRC16 using polynomial X^16 + X^15 + X^2 + X^0 (reflected 0xA001)
+#define OW_CRC16_POLY   0xA001
+
+extern const uint8_t ow_crc8_table[256];
+extern const uint16_t ow_crc16_table[256];
+
+// fold a single byte into a running CRC
+static inline uint8_t crc8_byte(uint8_t crc, uint8_t b) { return ow_crc8_table[crc ^ b]; }
+static inline uint16_t crc16_byte(uint16_t crc, uint8_t b) { return (crc >> 8) ^ ow_crc16_table[(crc ^ b) & 0xFF]; }
+
+// Compute a Dallas Semiconductor 8 bit CRC. These show up in the ROM and the registers.
+uint8_t crc8(const uint8_t *addr, uint8_t len);
+// continue an 8 bit CRC from a previously computed value
+uint8_t crc8_update(uint8_t crc, const uint8_t *addr, uint32_t len);
+
+// Compute a Dallas Semiconductor 16 bit CRC, as used by the memory function commands of the
+// EEPROM and counter families. Note the device transmits the inverted value.
+uint16_t crc16(const uint8_t *input, uint32_t len, uint16_t crc);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_CRC_H
@@ -0,0 +1,60 @@
+//
+// Per chip log buffer. Log records of a transaction (reset to reset) are collected and written out
+// with a single write instead of a printf per line, optionally as a one line per byte summary.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_LOG_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OW_LOG_BUF_LEN 4096
+
+typedef enum {
+    LOG_FMT_DIRECT,         // printf as we go
+    LOG_FMT_BUFFERED,       // collect, write once per transaction
+    LOG_FMT_BYTES,          // buffered, plus a line per byte received/sent
+
+    LOG_FMT_MAX
+} log_format_t;
+
+typedef struct ow_log {
+    uint8_t format;
+    uint32_t len;
+    uint32_t truncated;     // records that did not fit an empty buffer
+    char buf[OW_LOG_BUF_LEN];
+} ow_log_t;
+
+// Runtime filter, parsed once from the `logFilter` attribute, e.g. "sm_sig:off,sm_search:trace,cmd:0xBE".
+// State machines listed get their own level, listing commands limits output to transactions running
+// one of them (errors and warnings are always let through)
+typedef struct ow_filter {
+    uint32_t sm_set;            // bit per state machine id that has its own level
+    uint8_t sm_level[32];
+    uint32_t cmds[8];           // bit per command opcode
+    bool cmd_filter;
+    bool cmd_active;            // the current transaction runs a listed command
+} ow_filter_t;
+
+struct sm_cfg;
+
+void ow_log_init(ow_log_t *l);
+// append to the buffer, or printf when the log is NULL or direct
+void ow_log_printf(ow_log_t *l, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// byte summary record, LOG_FMT_BYTES only
+void ow_log_byte(ow_log_t *l, const char *dir, uint8_t b);
+// write out whatever has been collected
+void ow_log_flush(ow_log_t *l);
+
+// parse the filter, state machine names are looked up in cfgs. Returns false if there's no filter
+bool ow_filter_init(ow_filter_t *f, struct sm_cfg **cfgs, int n);
+// a command byte was received, a listed one sets cmd_active until the next reset
+void ow_filter_command(ow_filter_t *f, uint8_t cmd);
+// effective log level for cfg (may be NULL) given the base level
+uint8_t ow_filter_level(const ow_filter_t *f, uint8_t base, const struct sm_cfg *cfg);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_LOG_H
@@ -0,0 +1,132 @@
+//
+// Host callback recorder - logs every input the simulator hands the chip, enabled by the
+// `recordLog` attribute: pin watch and timer callbacks with their times, and the values returned
+// by attribute, string, pin and ADC reads. host/ow_recplay.c re-drives the chip from the log
+// without a simulator, so a session seen in Wokwi can be reproduced and profiled natively.
+//
+// The Wokwi imports are wrapped by the macros below, which every chip source gets through ow.h.
+// Callbacks are routed through trampolines that log them and pins and timers are logged by the
+// order they were created in, not by their handles. Pin writes and mode changes of the chip are
+// logged too, the replayer checks them and places the callbacks they trigger.
+//
+//   record   type, varint time delta (top level callbacks and the start record only), varint
+//            value, then for strings the string bytes
+//
+// Records are written out through stdout as `~R <seq> <hex>` lines when the buffer fills and on
+// every reset pulse. Each chip runs in its own wasm instance, so there's a single recorder; in
+// the host build only the first chip with `recordLog` set is recorded.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_REC_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_REC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define OW_REC_LEN          512     // bytes buffered before they are written out
+#define OW_REC_LINE         64      // bytes per ~R line
+#define OW_REC_PINS         8
+#define OW_REC_TIMERS       8
+#define OW_REC_VERSION      2
+
+// record types
+#define REC_START           0       // chip_init, value is OW_REC_VERSION
+#define REC_PIN             1       // pin watch callback, value is pin index << 1 | level
+#define REC_TIMER           2       // timer callback, value is the timer index
+#define REC_ATTR            3       // attr_read, attr_read_float as the float bits
+#define REC_READ            4       // pin_read
+#define REC_ADC             5       // pin_adc_read, float bits
+#define REC_STRING          6       // string_read, value is the length, the bytes follow
+#define REC_OUT             7       // pin_mode or pin_write of the chip, see REC_OUT_VALUE
+#define REC_NESTED          0x80    // callback made from within another one, no time delta
+
+#define REC_OUT_VALUE(idx, write, v)    ((uint32_t)(idx) << 6 | (write) << 5 | ((v) & 0x1F))
+
+typedef struct ow_rec {
+    bool on;                // recording this chip
+    bool active;            // in chip_init or one of its callbacks, reads are logged
+    uint8_t depth;          // callback nesting
+    uint32_t seq;           // lines written
+    uint64_t time;          // time of the last timed record
+    uint32_t pins[OW_REC_PINS];
+    uint8_t num_pins;
+    pin_watch_config_t watches[OW_REC_PINS];
+    timer_config_t timers[OW_REC_TIMERS];
+    uint8_t num_timers;
+    uint32_t len;
+    uint8_t buf[OW_REC_LEN];
+} ow_rec_t;
+
+extern ow_rec_t ow_rec;
+
+// called first in chip_init, returns false when `recordLog` is 0 or another chip is recorded
+bool ow_rec_init(void);
+// end of chip_init, reads from here on are logged in callbacks only
+void ow_rec_init_done(void);
+void ow_rec_flush(void);
+
+void ow_rec_put(uint8_t type, uint32_t value);
+void ow_rec_put_string(uint32_t len, const char *buf);
+pin_t ow_rec_pin_init(const char *name, uint32_t mode);
+bool ow_rec_pin_watch(pin_t pin, const pin_watch_config_t *config);
+timer_t ow_rec_timer_init(const timer_config_t *config);
+void ow_rec_put_out(pin_t pin, uint32_t write, uint32_t value);
+
+static inline uint32_t ow_rec_read(uint8_t type, uint32_t v) {
+    if (ow_rec.active) ow_rec_put(type, v);
+    return v;
+}
+
+static inline float ow_rec_float(uint8_t type, float v) {
+    if (ow_rec.active) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        ow_rec_put(type, bits);
+    }
+    return v;
+}
+
+static inline uint32_t ow_rec_string(uint32_t len, const char *buf) {
+    if (ow_rec.active) ow_rec_put_string(len, buf);
+    return len;
+}
+
+// outputs are made with logging off, whatever they trigger elsewhere is not this chip's input
+static inline void ow_rec_pin_mode(pin_t pin, uint32_t value) {
+    if (!ow_rec.active) {
+        (pin_mode)(pin, value);
+        return;
+    }
+    ow_rec_put_out(pin, 0, value);
+    ow_rec.active = false;
+    (pin_mode)(pin, value);
+    ow_rec.active = true;
+}
+
+static inline void ow_rec_pin_write(pin_t pin, uint32_t value) {
+    if (!ow_rec.active) {
+        (pin_write)(pin, value);
+        return;
+    }
+    ow_rec_put_out(pin, 1, value);
+    ow_rec.active = false;
+    (pin_write)(pin, value);
+    ow_rec.active = true;
+}
+
+#define pin_init(name, mode)        ow_rec_pin_init(name, mode)
+#define pin_watch(pin, cfg)         ow_rec_pin_watch(pin, cfg)
+#define timer_init(cfg)             ow_rec_timer_init(cfg)
+#define pin_read(pin)               ow_rec_read(REC_READ, (pin_read)(pin))
+#define pin_adc_read(pin)           ow_rec_float(REC_ADC, (pin_adc_read)(pin))
+#define attr_read(attr)             ow_rec_read(REC_ATTR, (attr_read)(attr))
+#define attr_read_float(attr)       ow_rec_float(REC_ATTR, (attr_read_float)(attr))
+#define string_read(s, buf, size)   ow_rec_string((string_read)(s, buf, size), buf)
+#define pin_mode(pin, value)        ow_rec_pin_mode(pin, value)
+#define pin_write(pin, value)       ow_rec_pin_write(pin, value)
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_REC_H
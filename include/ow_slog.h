@@ -0,0 +1,56 @@
+//
+// State log - timestamped changes of the state variables of every layer (signalling, byte and
+// command state machines, chip state), enabled by the `stateLog` attribute. Written out through
+// the chip log as `~W`/`~S` lines, which tools/state_vcd.c turns into a VCD that can be merged
+// with a Wokwi logic analyzer capture.
+//
+//   ~W <wire> <bits> <name>        wire declaration, once at start up
+//   ~S <time ns> <wire> <value>    value change
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_SLOG_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_SLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OW_SLOG_LEN     512     // changes buffered before they are written out
+#define OW_SLOG_WIRES   8
+
+struct ow_log;
+
+typedef struct ow_slog_wire {
+    const char *name;
+    const void *p;          // watched variable
+    uint8_t size;           // its size, 1 or 4 bytes
+    uint8_t bits;           // wire width in the VCD
+    uint32_t last;
+} ow_slog_wire_t;
+
+typedef struct ow_slog_rec {
+    uint64_t time;
+    uint8_t wire;
+    uint32_t value;         // as wide as the widest watched variable
+} ow_slog_rec_t;
+
+typedef struct ow_slog {
+    ow_slog_wire_t wires[OW_SLOG_WIRES];
+    uint8_t num_wires;
+    uint32_t len;
+    struct ow_log *log;     // where the records are written out, NULL prints directly
+    ow_slog_rec_t rec[OW_SLOG_LEN];
+} ow_slog_t;
+
+// returns false when `stateLog` is 0, the state log is then off
+bool ow_slog_init(ow_slog_t *l, struct ow_log *log);
+void ow_slog_watch(ow_slog_t *l, const char *name, const void *p, uint8_t size, uint8_t bits);
+// record the watched variables that changed since the last call
+void ow_slog_sample(ow_slog_t *l);
+void ow_slog_flush(ow_slog_t *l);
+
+#define OW_SLOG_SAMPLE(l)   { if (l) { ow_slog_sample(l); } }
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_SLOG_H
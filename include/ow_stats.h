@@ -0,0 +1,113 @@
+//
+// Hot path counters - plain increments on the signalling, byte and command paths, plus a count per
+// (state, event) transition of every state machine. Printed according to the `statsDump` attribute.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_STATS_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define OW_STATS_MAX_SM     16      // state machine configs that can be registered, at most 31
+#define OW_STATS_MAX_TRANS  256     // (state, event) entries across all registered state machines
+
+#define OW_HIST_BINS        16      // bins between the underflow and overflow bins
+
+struct sm_cfg;
+struct ow_telem;
+
+typedef enum {
+    STATS_DUMP_OFF,
+    STATS_DUMP_ONCE,            // dump on the next reset pulse after the attribute changes to this value
+    STATS_DUMP_EVERY_RESET,     // dump after every reset pulse
+
+    STATS_DUMP_MAX
+} stats_dump_t;
+
+// master timing, as seen from the slave side of the bus
+typedef enum {
+    HIST_RESET,         // reset pulse low time
+    HIST_RECOVERY,      // bus high time before a slot starts
+    HIST_WRITE_0,       // write 0 slot low time
+    HIST_WRITE_1,       // write 1 slot low time
+    HIST_READ_INIT,     // read slot initiation low time (only measurable when sending a 1)
+    HIST_SLOT,          // slot start to next slot start
+
+    HIST_MAX
+} ow_hist_id_t;
+
+// where the bus time goes
+typedef enum {
+    BUS_IDLE,
+    BUS_RESET,          // reset pulse and presence
+    BUS_WRITE,          // master write slots
+    BUS_READ,           // master read slots
+
+    BUS_MAX
+} ow_bus_phase_t;
+
+typedef struct ow_hist {
+    uint32_t lo_ns;             // lower edge of the first bin
+    uint32_t width_ns;          // bin width
+    uint32_t spec_min_ns;       // out of spec below this
+    uint32_t spec_max_ns;       // out of spec above this, 0 if there's no upper limit
+    uint32_t count;
+    uint32_t out_of_spec;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint64_t sum_ns;
+    uint32_t bins[OW_HIST_BINS + 2];    // [0] underflow, [OW_HIST_BINS + 1] overflow
+} ow_hist_t;
+
+typedef struct ow_stats {
+    uint32_t edges;             // DQ pin changes
+    uint32_t resets;            // completed reset/presence sequences
+    uint32_t forced_resets;     // bus held low past the reset detection timeout
+    uint32_t write_slots;       // master write slots, bits received
+    uint32_t read_slots;        // master read slots, bits sent
+    uint32_t not_impl;          // events handled by on_not_impl
+    uint32_t unhandled;         // events without a state machine entry
+    uint32_t errors;            // protocol errors that reset the state machines
+    uint32_t crc_updates;       // scratch pad CRC recomputations
+    uint32_t cmds[256];         // per ROM/function command opcode
+    uint32_t trans[OW_STATS_MAX_TRANS];     // per state machine entry, offset by sm_cfg_t.stats_base
+    ow_hist_t hist[HIST_MAX];
+
+    // bus utilisation
+    uint64_t start_ns;          // when counting started
+    uint64_t bus_ns[BUS_MAX];   // time spent per phase, excluding the current one
+    uint64_t phase_start_ns;
+    uint8_t bus_phase;
+    bool after_slot;            // the current idle period follows a slot
+    uint64_t idle_gap_ns;       // idle time between consecutive slots
+    uint32_t idle_gaps;
+    uint64_t conv_ns;           // time spent converting, overlaps the bus phases
+    uint32_t conversions;
+    uint32_t bytes_rx;
+    uint32_t bytes_tx;
+
+    uint32_t dump_attr;
+    uint32_t dump_last;
+    struct ow_telem *telem;     // dumps go to the telemetry stream instead of stdout when set
+} ow_stats_t;
+
+#define OW_STATS_INC(s, field)  { if (s) { (s)->field++; } }
+// count a transition through entry e of cfg
+#define OW_STATS_TRANS(s, cfg, e)  { if ((s) && (cfg)->stats_base >= 0) { (s)->trans[(cfg)->stats_base + ((e) - (cfg)->sm_entries)]++; } }
+
+void ow_stats_init(ow_stats_t *s);
+// assign the config an id and its slice of the transition counters. Called when its hash is built,
+// or earlier by whoever needs the id. Registering again has no effect
+void ow_stats_register(struct sm_cfg *cfg);
+void ow_hist_add(ow_hist_t *h, uint64_t ns);
+// account the time since the last phase change to the current phase and switch to the new one
+void ow_stats_bus_phase(ow_stats_t *s, ow_bus_phase_t phase, uint64_t now);
+void ow_stats_dump(ow_stats_t *s);
+// called on every reset pulse, dumps according to `statsDump`
+void ow_stats_on_reset_pulse(ow_stats_t *s);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_STATS_H
@@ -0,0 +1,58 @@
+//
+// Binary telemetry - counters, master timing histograms and flight recorder dumps streamed as
+// framed records over an optional UART on the TELEM pin, enabled by the `telemBaud` attribute.
+// Frames are collected during a transaction and written out on the next reset pulse.
+//
+// Frame layout, multi byte fields little endian:
+//   0xA5 | type | len (2) | payload (len) | crc16 (2, Dow-CRC16 of type, len and payload)
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_TELEM_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_TELEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wokwi-api.h"
+
+#define OW_TELEM_BUF_LEN    2048    // per buffer, one is filled while the other is written out
+#define OW_TELEM_SYNC       0xA5
+
+struct sm_cfg;
+struct ow_stats;
+struct ow_hist;
+struct ow_trace;
+
+typedef enum {
+    TELEM_HELLO = 1,    // rom id (8)
+    TELEM_COUNTERS,     // time ns (8), then u32: edges, resets, forced resets, write slots, read slots,
+                        // not implemented, unhandled, errors, crc updates, bytes rx, bytes tx
+    TELEM_HIST,         // id (1), lo, width, count, out of spec, min, max (u32), sum (8), bins (u32 * OW_HIST_BINS + 2)
+    TELEM_TRACE,        // total records (u32), then per record: time ns (8), sm id (1), state (1), event (1), data (2)
+    TELEM_SM_NAME,      // sm id (1), name, sent before the first trace record of a state machine
+
+    TELEM_MAX
+} telem_frame_t;
+
+typedef struct ow_telem {
+    uart_dev_t uart;
+    bool enabled;
+    bool busy;              // a buffer is being written out
+    uint8_t active;         // buffer being filled
+    uint32_t len;
+    uint32_t dropped;       // frames that did not fit
+    uint32_t sm_named;      // bit per state machine id whose name has been sent
+    uint8_t buf[2][OW_TELEM_BUF_LEN];
+} ow_telem_t;
+
+// returns false when `telemBaud` is 0, telemetry is then off
+bool ow_telem_init(ow_telem_t *t, const uint8_t *rom_id);
+void ow_telem_counters(ow_telem_t *t, const struct ow_stats *s);
+void ow_telem_hist(ow_telem_t *t, uint8_t id, const struct ow_hist *h);
+void ow_telem_trace(ow_telem_t *t, const struct ow_trace *tr);
+// end of transaction, start writing out what has been collected
+void ow_telem_flush(ow_telem_t *t);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_TELEM_H
@@ -0,0 +1,66 @@
+//
+// Flight recorder - a fixed size ring of compact binary state machine event records, decoded and
+// printed only when something goes wrong (or when asked to via the `traceDump` attribute).
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+//
+
+#ifndef WOKWI_DS1820_CUSTOM_CHIP_OW_TRACE_H
+#define WOKWI_DS1820_CUSTOM_CHIP_OW_TRACE_H
+
+#include <stdint.h>
+#include "wokwi-api.h"
+
+#define OW_TRACE_LEN 128    // records kept, must be a power of 2
+
+struct sm_cfg;
+struct ow_telem;
+
+typedef enum {
+    TRACE_DUMP_OFF,         // record only
+    TRACE_DUMP_ON_FAULT,    // dump when an error path resets the state machines
+    TRACE_DUMP_ON_RESET,    // dump on faults and on every reset pulse
+
+    TRACE_DUMP_MAX
+} trace_dump_t;
+
+typedef struct ow_trace_rec {
+    uint64_t time;                  // sim time, ns
+    const struct sm_cfg *cfg;       // state machine the event was pushed to, used to decode names
+    uint8_t state;
+    uint8_t event;
+    uint16_t data;
+} ow_trace_rec_t;
+
+typedef struct ow_trace {
+    ow_trace_rec_t rec[OW_TRACE_LEN];
+    uint32_t count;         // records written so far, the ring index is count % OW_TRACE_LEN
+    const char *fault;      // set by an error path, dumped by the next state reset
+    uint32_t dump_attr;
+    struct ow_telem *telem; // dumps go to the telemetry stream instead of stdout when set
+} ow_trace_t;
+
+static inline void ow_trace_record(ow_trace_t *t, const struct sm_cfg *cfg, uint32_t state, uint32_t event, uint32_t data) {
+    if (t == NULL) {
+        return;
+    }
+    ow_trace_rec_t *r = &t->rec[t->count++ & (OW_TRACE_LEN - 1)];
+    r->time = get_sim_nanos();
+    r->cfg = cfg;
+    r->state = state;
+    r->event = event;
+    r->data = data;
+}
+
+// mark a fault, the trace is dumped once the state machines are reset
+#define OW_TRACE_FAULT(t, why)  { if (t) { (t)->fault = (why); } }
+
+void ow_trace_init(ow_trace_t *t);
+void ow_trace_dump(ow_trace_t *t, const char *why);
+// called by the state reset paths, dumps a pending fault according to `traceDump`
+void ow_trace_on_state_reset(ow_trace_t *t);
+// called on every reset pulse
+void ow_trace_on_reset_pulse(ow_trace_t *t);
+
+#endif //WOKWI_DS1820_CUSTOM_CHIP_OW_TRACE_H
@@ -11,18 +11,20 @@
 #include <math.h>
 #include <ctype.h>
 #include "ow.h"
-
-#define DEBUG 1
+#include "ow_crc.h"
+#include "ow_telem.h"
 
 #define max(a, b) ({__typeof__(a) _a = (a); __typeof__(b) _b = b; _a > _b ? _a : b; })
 #define min(a, b) ({__typeof__(a) _a = (a); __typeof__(b) _b = b; _a < _b ? _a : b; })
-#define constrain(v, a, b) ({__typeof__(v) _v = (v); __typeof__(a) _a = (a); __typeof__(b) _b = b; min(max(v,a),b); })
+#define constrain(v, a, b) ({__typeof__(v) _v = (v); __typeof__(a) _a = (a); __typeof__(b) _b = (b); _v < _a ? _a : _v > _b ? _b : _v; })
 #define in_range(v, a, b) ({__typeof__(v) _v = (v); __typeof__(a) _a = (a); __typeof__(b) _b = b; _a <= _v && _v <= _b; })
 
 // --------------- Debug Macros -----------------------
-#ifdef DEBUG
-#define DEBUGF(...)      { if (chip->genDebug) {printf("%lld ", get_sim_nanos()/1000); printf(__VA_ARGS__);} }
-char buf[200];
+// chip level logging, see the log levels in ow.h
+#define LOGF(lvl, ...)   { if (LOG_ON(chip->diag.log_level, lvl)) {ow_log_printf(chip->diag.log, "%" PRIu64 " ", get_sim_nanos()/1000); ow_log_printf(chip->diag.log, __VA_ARGS__);} }
+#define DEBUGF(...)      LOGF(LOG_TRACE, __VA_ARGS__)
+// shared by all instances, the strings are used straight away by the log call they're made for
+static char buf[16 * 9 + 1];
 
 
 const char*debugBinStr(char *p, size_t c) {
@@ -49,20 +51,18 @@ const char*debugHexStr(uint8_t *p, size_t c) {
     *pb = 0;
     return buf;
 }
-
-#endif //  DEBUG
 // --------------- Debug Macros -----------------------
 
 // buffers
-#define BUF_LEN 32
 #define SERIAL_LEN 8
 #define SCRATCH_LEN 9
 #define EEPROM_LEN 3
-#define CUR_BIT(chip) ((chip->buffer[chip->byte_ndx] & (1 << chip->bit_ndx)) != 0)
+#define CUR_BIT(chip) ((chip->tx.data[chip->tx.byte_ndx] >> chip->tx.bit_ndx) & 1)
 
 // Temperature consts
 #define MAX_TEMPERATURE (125)
 #define MIN_TEMPERATURE (-55)
+#define DEF_TEMP_IN_VREF (5.0)
 
 // Temperature sensor family codes (byte 0 of serial number)
 #define DS_FC_18S20     0x10
@@ -71,20 +71,6 @@ const char*debugHexStr(uint8_t *p, size_t c) {
 // #define DS_FC_1825      0x3B
 // #define DS_FC_28EA00    0x42
 
-// rom commands
-#define OW_CMD_SEARCH           0xF0
-#define OW_CMD_READ             0x33
-#define OW_CMD_MATCH            0x55
-#define OW_CMD_SKIP             0xCC
-#define OW_CMD_ALM_SEARCH       0xEC
-
-#define DS_CMD_CONVERT          0x44
-#define DS_CMD_WR_SCRATCH       0x4E
-#define DS_CMD_RD_SCRATCH       0xBE
-#define DS_CMD_CP_SCRATCH       0x48
-#define DS_CMD_RECALL           0xB8
-#define DS_CMD_RD_PWD           0xB4
-
 // scratch pad offsets (DS18B20)
 #define CHIP_SP_TEMP_LOW_OFF    0x00
 #define CHIP_SP_TEMP_HI_OFF     0x01
@@ -109,12 +95,17 @@ const char*debugHexStr(uint8_t *p, size_t c) {
 #define CHIP_CFG_TEMP_BITS_MASK 0x60
 #define CHIP_CFG_TEMP_BITS_OFF  5      
 
+// Conversion times (us), DS18B20 halves the 12 bit time for every bit of resolution dropped
+#define DS_CONV_TIME_12BIT_US   750000
+#define DS_CONV_TIME_18S20_US   750000
+
 
 typedef enum {
     TW_FIXED,
     TW_SQUARE,
     TW_SINE,
-    TW_TRIANGLE
+    TW_TRIANGLE,
+    TW_ANALOG
 } wave_mode_t;
 
 typedef enum {
@@ -159,6 +150,11 @@ typedef enum {
     ST_MASTER_RD_BIT_MAX
 } wr_bit_state_t;
 
+typedef enum {
+    ST_MASTER_CONV_BUSY_BIT_WRITTEN,
+    ST_MASTER_CONV_BUSY_MAX
+} conv_busy_state_t;
+
 typedef struct  {
     uint8_t bit_ndx;
 } cmd_search_ctx_t;
@@ -168,10 +164,18 @@ typedef struct  {
 
 typedef struct  {
     int byte_ndx;
-    int resp_len;
     bool restart_when_done;
 } cmd_byte_op_ctx_t;
 
+// transmit descriptor - the response is sent straight from its source (serial_no, a constant
+// status bit, ...) unless the source can change while it is sent
+typedef struct {
+    const uint8_t *data;
+    uint8_t len;
+    uint8_t byte_ndx;
+    uint8_t bit_ndx;
+} tx_desc_t;
+
 typedef struct {
     uint32_t state;
     sm_t *cmd_sm;
@@ -183,11 +187,15 @@ typedef struct {
     } cmd_data;
 } cmd_ctx_t;
 
+typedef struct ds_family_ops ds_family_ops_t;
+
 typedef struct
 {
     uint8_t serial_no[SERIAL_LEN];
     uint8_t scratch_pad[SCRATCH_LEN];
+    uint8_t sp_crc[SCRATCH_LEN];            // running CRC of the scratch pad bytes before each offset
     uint8_t eeprom[EEPROM_LEN];
+    const ds_family_ops_t *ops;             // family specific behaviour, selected from familyCode
 
     // onw wire helpers
     ow_ctx_t *ow_ctx;
@@ -199,10 +207,9 @@ typedef struct
     cmd_ctx_t cmd_ctx;              // current command context
     uint32_t rom_command;           // remember the current command (needed for search/almsearch)
 
-    // comms buffer
-    uint8_t buffer[BUF_LEN];        
-    int bit_ndx;
-    int byte_ndx;
+    // current response and its bit cursor
+    tx_desc_t tx;
+    uint8_t tx_scratch_pad[SCRATCH_LEN];    // read scratchpad sends this copy, a conversion may end mid read
 
     // the temperature from config and alarm value based on last conversion
     float temperature;
@@ -214,6 +221,13 @@ typedef struct
     timer_t temp_wave_timer;
     wave_mode_t temp_mode;
     int temp_wave_slot;
+    pin_t temp_pin;                 // analog temperature source, sampled once per conversion
+    float temp_in_vref;             // voltage on temp_pin that maps to maxTemp
+
+    // temperature conversion in progress, committed to the scratch pad when conv_timer expires
+    timer_t conv_timer;
+    bool converting;
+    uint64_t conv_start;
 
     
 
@@ -223,12 +237,36 @@ typedef struct
 
     // debug
     bool debug_timer;
-    bool owDebug;
-    bool genDebug;
+    ow_diag_t diag;
+    ow_trace_t trace;
+    ow_stats_t stats;
+    ow_log_t log;
+    ow_filter_t filter;
+    ow_telem_t telem;
+    ow_slog_t slog;
 
 } chip_desc_t;
 
 
+// family specific operations, selected once in chip_attr_init
+struct ds_family_ops {
+    uint8_t family_code;
+    uint8_t wr_sp_len;                                  // bytes accepted by write scratchpad
+    void (*reset_scratch_pad)(chip_desc_t *chip);       // power on values of the reserved bytes
+    void (*encode_temperature)(chip_desc_t *chip);      // write chip->temperature into the scratch pad
+    uint32_t (*conversion_time_us)(chip_desc_t *chip);
+    void (*copy_scratchpad)(chip_desc_t *chip);         // scratch pad -> eeprom
+    void (*recall)(chip_desc_t *chip);                  // eeprom -> scratch pad
+};
+
+// Building with DS_FAMILY set (e.g. -DDS_FAMILY=0x28) compiles out the other families and
+// resolves the family operations at compile time
+#ifdef DS_FAMILY
+#define FAMILY_OPS(chip) (&DS_FAMILY_OPS)
+#else
+#define FAMILY_OPS(chip) ((chip)->ops)
+#endif
+
 typedef void (*ow_cmd_handler)(chip_desc_t *chip);
 typedef struct {
     uint16_t cmd_key;
@@ -241,6 +279,7 @@ typedef HASHMAP(uint16_t, cmd_entry_t) cmd_map_t;
 static void chip_reset_state(chip_desc_t *chip);
 
 void on_timer_event(void *user_data);
+void on_conv_timer_event(void *user_data);
 void on_forced_reset_cb(void *d, uint32_t err, uint32_t data) ;
 void on_reset_cb(void *d, uint32_t err, uint32_t data) ;
 void on_bit_written_cb(void *d, uint32_t err, uint32_t data);
@@ -263,6 +302,7 @@ static void on_master_wr_sp_byte_read(void *user_data, uint32_t data);
 static void on_master_rd_byte_byte_written(void *user_data, uint32_t data);
 
 static void on_master_rd_bit_bit_written(void *user_data, uint32_t data);
+static void on_master_conv_busy_bit_written(void *user_data, uint32_t data);
 
 // --- command handlers 
 static void on_rom_command(chip_desc_t *chip, uint8_t cmd);
@@ -281,6 +321,23 @@ static void on_ds_copy_scratchpad(chip_desc_t *chip);
 static void on_ds_recall(chip_desc_t *chip);
 static void on_ds_read_power(chip_desc_t *chip);
 
+// --- family operations
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18S20
+static void ds18s20_reset_scratch_pad(chip_desc_t *chip);
+static void ds18s20_encode_temperature(chip_desc_t *chip);
+static uint32_t ds18s20_conversion_time_us(chip_desc_t *chip);
+static void ds18s20_copy_scratchpad(chip_desc_t *chip);
+static void ds18s20_recall(chip_desc_t *chip);
+#endif
+
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18B20
+static void ds18b20_reset_scratch_pad(chip_desc_t *chip);
+static void ds18b20_encode_temperature(chip_desc_t *chip);
+static uint32_t ds18b20_conversion_time_us(chip_desc_t *chip);
+static void ds18b20_copy_scratchpad(chip_desc_t *chip);
+static void ds18b20_recall(chip_desc_t *chip);
+#endif
+
 
 
 // ==== Search SM ====
@@ -330,13 +387,15 @@ static sm_t *sm_match = &(sm_t){.cfg = &sm_match_cfg};
 
 // ==== Write Scratchpad SM ====
 
+static sm_entry_t sm_wr_sp_entries[] = { //[ST_MASTER_MATCH_MAX][EV_MASTER_MATCH_MAX] = {
+        // ST_MASTER_MATCH_READ_BIT
+        SM_E(ST_MASTER_WR_SP_BYTE_READ, EV_BYTE_READ, on_master_wr_sp_byte_read),
+};
+
 static sm_cfg_t sm_wr_sp_cfg = {
         .name = "sm_wr_sp_cfg",
-        .sm_entries = (sm_entry_t[]){ //[ST_MASTER_MATCH_MAX][EV_MASTER_MATCH_MAX] = {
-                // ST_MASTER_MATCH_READ_BIT
-                SM_E(ST_MASTER_WR_SP_BYTE_READ, EV_BYTE_READ, on_master_wr_sp_byte_read),
-        },
-        .num_entries = 1,
+        .sm_entries = sm_wr_sp_entries,
+        .num_entries = sizeof(sm_wr_sp_entries)/sizeof(sm_entry_t),
 };
 
 static sm_t *sm_wr_sp = &(sm_t){.cfg = &sm_wr_sp_cfg};
@@ -344,32 +403,93 @@ static sm_t *sm_wr_sp = &(sm_t){.cfg = &sm_wr_sp_cfg};
 
 // ==== Read Byte SM ====
 
+static sm_entry_t sm_rd_byte_entries[] = {
+        // ST_MASTER_RD_SP_BYTE_RD
+        SM_E(ST_MASTER_RD_BYTE_BYTE_WRITTEN, EV_BYTE_WRITTEN, on_master_rd_byte_byte_written),
+};
+
 static sm_cfg_t sm_rd_byte_cfg = {
         .name = "sm_rd_byte",
-        .sm_entries = (sm_entry_t[]){
-                // ST_MASTER_RD_SP_BYTE_RD
-                SM_E(ST_MASTER_RD_BYTE_BYTE_WRITTEN, EV_BYTE_WRITTEN, on_master_rd_byte_byte_written),
-        },
-        .num_entries = 1,
+        .sm_entries = sm_rd_byte_entries,
+        .num_entries = sizeof(sm_rd_byte_entries)/sizeof(sm_entry_t),
 };
 
 static sm_t *sm_rd_byte = &(sm_t){.cfg = &sm_rd_byte_cfg};
 
 
+static sm_entry_t sm_wr_bit_entries[] = {
+        // ST_MASTER_RD_SP_BYTE_RD
+        SM_E(ST_MASTER_RD_BIT_BIT_WRITTEN, EV_BIT_WRITTEN, on_master_rd_bit_bit_written),
+};
+
 static sm_cfg_t sm_wr_bit_cfg = {
         .name = "sm_wr_bit",
-        .sm_entries = (sm_entry_t[]){
-                // ST_MASTER_RD_SP_BYTE_RD
-                SM_E(ST_MASTER_RD_BIT_BIT_WRITTEN, EV_BIT_WRITTEN, on_master_rd_bit_bit_written),
-        },
-        .num_entries = 1,
+        .sm_entries = sm_wr_bit_entries,
+        .num_entries = sizeof(sm_wr_bit_entries)/sizeof(sm_entry_t),
 };
 
 static sm_t *sm_wr_bit = &(sm_t){.cfg = &sm_wr_bit_cfg};
 
 
-static uint8_t supported_familyCodes[] = { 
-    DS_FC_18S20, DS_FC_18B20//, DS_FC_1822
+// ==== Conversion Busy SM ====
+
+static sm_entry_t sm_conv_busy_entries[] = {
+        // ST_MASTER_CONV_BUSY_BIT_WRITTEN
+        SM_E(ST_MASTER_CONV_BUSY_BIT_WRITTEN, EV_BIT_WRITTEN, on_master_conv_busy_bit_written),
+};
+
+static sm_cfg_t sm_conv_busy_cfg = {
+        .name = "sm_conv_busy",
+        .sm_entries = sm_conv_busy_entries,
+        .num_entries = sizeof(sm_conv_busy_entries)/sizeof(sm_entry_t),
+};
+
+static sm_t *sm_conv_busy = &(sm_t){.cfg = &sm_conv_busy_cfg};
+
+
+// single bit responses (read power supply, conversion busy)
+static const uint8_t tx_bits[] = { 0, 1 };
+
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18S20
+static const ds_family_ops_t ds18s20_ops = {
+    .family_code = DS_FC_18S20,
+    .wr_sp_len = 2,
+    .reset_scratch_pad = ds18s20_reset_scratch_pad,
+    .encode_temperature = ds18s20_encode_temperature,
+    .conversion_time_us = ds18s20_conversion_time_us,
+    .copy_scratchpad = ds18s20_copy_scratchpad,
+    .recall = ds18s20_recall,
+};
+#endif
+
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18B20
+static const ds_family_ops_t ds18b20_ops = {
+    .family_code = DS_FC_18B20,
+    .wr_sp_len = 3,
+    .reset_scratch_pad = ds18b20_reset_scratch_pad,
+    .encode_temperature = ds18b20_encode_temperature,
+    .conversion_time_us = ds18b20_conversion_time_us,
+    .copy_scratchpad = ds18b20_copy_scratchpad,
+    .recall = ds18b20_recall,
+};
+#endif
+
+#ifdef DS_FAMILY
+#if DS_FAMILY == DS_FC_18S20
+#define DS_FAMILY_OPS ds18s20_ops
+#elif DS_FAMILY == DS_FC_18B20
+#define DS_FAMILY_OPS ds18b20_ops
+#else
+#error "DS_FAMILY must be one of DS_FC_18S20 (0x10), DS_FC_18B20 (0x28)"
+#endif
+#endif
+
+static const ds_family_ops_t *supported_families[] = {
+#ifdef DS_FAMILY
+    &DS_FAMILY_OPS,
+#else
+    &ds18s20_ops, &ds18b20_ops, // DS_FC_1822
+#endif
 };
 
 static cmd_entry_t cmd_entries[] = {
@@ -387,34 +507,20 @@ static cmd_entry_t cmd_entries[] = {
     { ST_WAIT_FN_CMD << 8 | DS_CMD_RD_PWD, on_ds_read_power },
 };
 
+// read only once built, shared by all instances
 static cmd_map_t *cmd_map;
 
-// Dow-CRC using polynomial X^8 + X^5 + X^4 + X^0
-// Tiny 2x16 entry CRC table created by Arjen Lentz
-// See http://lentz.com.au/blog/calculating-crc-with-a-tiny-32-entry-lookup-table
-static const uint8_t dscrc2x16_table[] = {
-	0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83,
-	0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
-	0x00, 0x9D, 0x23, 0xBE, 0x46, 0xDB, 0x65, 0xF8,
-	0x8C, 0x11, 0xAF, 0x32, 0xCA, 0x57, 0xE9, 0x74
-};
-
-// Compute a Dallas Semiconductor 8 bit CRC. These show up in the ROM
-// and the registers.  (Use tiny 2x16 entry CRC table)
-uint8_t crc8(const uint8_t *addr, uint8_t len)
-{
-	uint8_t crc = 0;
-
-	while (len--) {
-		crc = *addr++ ^ crc;  // just re-using crc as intermediate
-		crc = dscrc2x16_table[crc & 0x0f] ^ dscrc2x16_table[ 16 + ((crc >> 4) & 0x0f)];
-	}
+// Recompute the scratch pad CRC from the first modified byte onward. sp_crc[i] holds the
+// CRC of the bytes before offset i, so the unchanged prefix does not need to be rescanned.
+void update_crc8(chip_desc_t *chip, int first) {
+    uint8_t crc = chip->sp_crc[first];
+    chip->stats.crc_updates++;
 
-	return crc;
-}
-
-void update_crc8(chip_desc_t *chip) {
-    chip->scratch_pad[CHIP_SP_CRC_OFF] = crc8(chip->scratch_pad, SCRATCH_LEN - 1);
+    for (int i = first; i < CHIP_SP_CRC_OFF; i++) {
+        crc = crc8_byte(crc, chip->scratch_pad[i]);
+        chip->sp_crc[i + 1] = crc;
+    }
+    chip->scratch_pad[CHIP_SP_CRC_OFF] = crc;
 }
 
 
@@ -422,6 +528,9 @@ int cmd_key_compare(const uint16_t *k1, const uint16_t *k2 ) { return *k1 == *k2
 size_t cmd_key_hash(const uint16_t *k1 ) { return hashmap_hash_default(k1, sizeof(*k1)); }
 uint16_t cmd_to_key(uint16_t state, uint16_t cmd) { return state << 8 | cmd; }
 void cmd_init_hash() {
+    if (cmd_map != NULL) {
+        return;
+    }
     cmd_map = calloc(1, sizeof(cmd_map_t));
 
     hashmap_init(cmd_map, cmd_key_hash, cmd_key_compare);
@@ -435,6 +544,19 @@ void cmd_init_hash() {
 
 // ==================== Implementation =========================
 
+static void tx_start(chip_desc_t *chip, const uint8_t *data, uint8_t len) {
+    chip->tx = (tx_desc_t){ .data = data, .len = len };
+}
+
+// move the cursor to the next bit, returns false once the whole response has been sent
+static bool tx_next_bit(chip_desc_t *chip) {
+    if (++chip->tx.bit_ndx >= 8) {
+        chip->tx.bit_ndx = 0;
+        chip->tx.byte_ndx++;
+    }
+    return chip->tx.byte_ndx < chip->tx.len;
+}
+
 void chip_attr_init(chip_desc_t *chip) {
     
     // read config attributes
@@ -442,8 +564,6 @@ void chip_attr_init(chip_desc_t *chip) {
     uint32_t len;
     char str_attr[SERIAL_LEN * 2];
     
-    attr = attr_init("owDebug", false); chip->owDebug = attr_read(attr) != 0;
-    attr = attr_init("genDebug", false); chip->genDebug = attr_read(attr) != 0;
     attr = attr_init("debug_timer", false); chip->debug_timer = attr_read(attr) != 0;
 
     attr = attr_init_float("temperature", 0);
@@ -456,13 +576,17 @@ void chip_attr_init(chip_desc_t *chip) {
     attr = attr_init_float("tempWaveFreq", 0);
     chip->temp_chg_freq = constrain(attr_read_float(attr), 0, 100);
     attr = attr_string_init("tempWaveForm");
-    len = string_read(attr, str_attr, 8 + 1 );  // allowing for none|sine|square|triangle 8 + NULL
-    printf("reading temp mode: %s\n", str_attr);
+    len = string_read(attr, str_attr, 8 + 1 );  // allowing for none|sine|square|triangle|analog 8 + NULL
+    LOGF(LOG_INFO, "reading temp mode: %s\n", str_attr);
     for(int i = 0; str_attr[i]; i++){ str_attr[i] = tolower(str_attr[i]); }
     chip->temp_mode = TW_FIXED;
     if (!strcmp(str_attr, "sine")) chip->temp_mode = TW_SINE;
     if (!strcmp(str_attr, "square")) chip->temp_mode = TW_SQUARE;
     if (!strcmp(str_attr, "triangle")) chip->temp_mode = TW_TRIANGLE;
+    if (!strcmp(str_attr, "analog")) chip->temp_mode = TW_ANALOG;
+    attr = attr_init_float("tempInVref", DEF_TEMP_IN_VREF);
+    chip->temp_in_vref = attr_read_float(attr);
+    if (chip->temp_in_vref <= 0) chip->temp_in_vref = DEF_TEMP_IN_VREF;
 
     if (chip->minTemp > chip->maxTemp) {
         float t = chip->minTemp;
@@ -472,14 +596,26 @@ void chip_attr_init(chip_desc_t *chip) {
 
     // initialise device id
     attr = attr_init("familyCode", DS_FC_18S20); chip->serial_no[0] = attr_read(attr) & 0xFF;
-    if (memchr(supported_familyCodes, chip->serial_no[0], sizeof(supported_familyCodes)) == NULL) {
-        printf("*** DS18B20 device family code not supported (%d), expect errors...\n", chip->serial_no[0]);
+    chip->ops = NULL;
+    for (int i = 0; i < sizeof(supported_families) / sizeof(supported_families[0]); i++) {
+        if (supported_families[i]->family_code == chip->serial_no[0]) chip->ops = supported_families[i];
+    }
+    if (chip->ops == NULL) {
+#ifdef DS_FAMILY
+        LOGF(LOG_WARN, "*** DS18B20 device family code not supported by this build (%d), using %d\n", chip->serial_no[0], DS_FAMILY);
+        chip->serial_no[0] = DS_FAMILY;
+        chip->ops = &DS_FAMILY_OPS;
+#else
+        // other families (e.g. DS1822) behave like the DS18B20
+        LOGF(LOG_WARN, "*** DS18B20 device family code not supported (%d), expect errors...\n", chip->serial_no[0]);
+        chip->ops = &ds18b20_ops;
+#endif
     }
 
     attr = attr_string_init("deviceID"); 
     len = string_read(attr, str_attr, 13 );  // expecting 12 Hex Digits + NULL
     if (len < 12) {
-        printf("*** DS18B20 device id too short (%d), expect errors...\n", len);
+        LOGF(LOG_WARN, "*** DS18B20 device id too short (%d), expect errors...\n", len);
     }
 
     for (int i = 0; i < 6; i++) {
@@ -496,9 +632,12 @@ void chip_attr_init(chip_desc_t *chip) {
 //    attr = attr_init("presence_time", PR_DUR_PULL_PRESENCE);
 //    chip->presence_time = attr_read(attr);
 
-    printf("*** DS18B20 setting attributes:\n  genDebug: %d\n  owDebug: %d\n  temperature: %f\n  familyCode: %2x\n"
+    if (!LOG_ON(chip->diag.log_level, LOG_INFO)) {
+        return;
+    }
+    printf("*** DS18B20 setting attributes:\n  logLevel: %d\n  temperature: %f\n  familyCode: %2x\n"
            "  minTemp: %f\n  maxTemp: %f\n  temp_freq: %f\n  temp_mode: %d\n", 
-    chip->genDebug, chip->owDebug, chip->temperature, chip->serial_no[0],
+    chip->diag.log_level, chip->temperature, chip->serial_no[0],
     chip->minTemp, chip->maxTemp, chip->temp_chg_freq, chip->temp_mode);
 
     printf("  deviceID: ");
@@ -511,10 +650,35 @@ void chip_attr_init(chip_desc_t *chip) {
 void chip_init()
 {
 //    setvbuf(stdout, NULL, _IOLBF, 1024);
-    printf("*** DS18B20 chip initialising...\n");
+    // first, so the recorder sees every input from here on
+    bool recording = ow_rec_init();
     chip_desc_t *chip = calloc(1, sizeof(chip_desc_t));
+    chip->diag.base_level = chip->diag.log_level = ow_log_level_init("genDebug");
+    LOGF(LOG_INFO, "*** DS18B20 chip initialising...\n");
 
     chip_attr_init(chip);
+    ow_trace_init(&chip->trace);
+    ow_stats_init(&chip->stats);
+    ow_log_init(&chip->log);
+    chip->diag.trace = &chip->trace;
+    chip->diag.stats = &chip->stats;
+    chip->diag.log = &chip->log;
+    if (ow_telem_init(&chip->telem, chip->serial_no)) {
+        chip->trace.telem = &chip->telem;
+        chip->stats.telem = &chip->telem;
+    }
+    if (ow_slog_init(&chip->slog, &chip->log)) {
+        chip->diag.slog = &chip->slog;
+    }
+
+    sm_cfg_t *sm_cfgs[] = {
+            sm_sig->cfg, sm_read_byte->cfg, sm_write_byte->cfg, &sm_search_cfg, &sm_match_cfg,
+            &sm_wr_sp_cfg, &sm_rd_byte_cfg, &sm_wr_bit_cfg, &sm_conv_busy_cfg,
+    };
+    if (ow_filter_init(&chip->filter, sm_cfgs, sizeof(sm_cfgs) / sizeof(sm_cfgs[0]))) {
+        chip->diag.filter = &chip->filter;
+        chip->diag.log_level = ow_filter_level(&chip->filter, chip->diag.base_level, NULL);
+    }
 
     ow_ctx_cfg_t cfg = {
             .bit_written_cb = on_bit_written_cb,
@@ -523,6 +687,11 @@ void chip_init()
             .forced_reset_cb = on_forced_reset_cb,
             .pin_name = "DQ",
             .data = chip,
+            .trace = &chip->trace,
+            .stats = &chip->stats,
+            .log = &chip->log,
+            .filter = chip->diag.filter,
+            .slog = chip->diag.slog,
     };
     ow_ctx_t *ow_ctx = ow_ctx_init(&cfg);
 
@@ -531,14 +700,30 @@ void chip_init()
     chip->ow_read_byte_ctx = ow_read_byte_ctx_init(chip, on_byte_read_cb, ow_ctx);
     chip->ow_write_byte_ctx = ow_write_byte_ctx_init(chip, on_byte_written_cb, ow_ctx);
 
+    if (chip->diag.slog != NULL) {
+        ow_slog_watch(&chip->slog, "sig", &ow_ctx->state, sizeof(ow_ctx->state), 8);
+        ow_slog_watch(&chip->slog, "rd_byte", &chip->ow_read_byte_ctx->state, sizeof(chip->ow_read_byte_ctx->state), 8);
+        ow_slog_watch(&chip->slog, "wr_byte", &chip->ow_write_byte_ctx->state, sizeof(chip->ow_write_byte_ctx->state), 8);
+        ow_slog_watch(&chip->slog, "sig_mode", &chip->sig_mode, sizeof(chip->sig_mode), 1);
+        ow_slog_watch(&chip->slog, "chip", &chip->state, sizeof(chip->state), 8);
+        ow_slog_watch(&chip->slog, "cmd", &chip->cmd_ctx.state, sizeof(chip->cmd_ctx.state), 8);
+        ow_slog_watch(&chip->slog, "converting", &chip->converting, sizeof(chip->converting), 1);
+    }
+
     // initialise command map
     cmd_init_hash();
 
     chip->vcc_pin = pin_init("VCC", INPUT);
     chip->powered = pin_read(chip->vcc_pin);
 
+    // analog temperature source is only sampled on conversion, no timer needed
+    chip->temp_pin = NO_PIN;
+    if (chip->temp_mode == TW_ANALOG) {
+        chip->temp_pin = pin_init("TEMP_IN", ANALOG);
+    }
+
     // initialise temperature timers if needed
-    if (chip->temp_mode != TW_FIXED && chip->temp_chg_freq > 0.001) {
+    if (chip->temp_mode != TW_FIXED && chip->temp_mode != TW_ANALOG && chip->temp_chg_freq > 0.001) {
         timer_config_t timer_cfg = {
             .user_data = chip,
             .callback = on_timer_event,
@@ -549,8 +734,19 @@ void chip_init()
         timer_start(chip->temp_wave_timer, (1e4 / chip->temp_chg_freq), true);
     }
 
+    // conversion completion deadline, armed once per Convert T
+    timer_config_t conv_timer_cfg = {
+        .user_data = chip,
+        .callback = on_conv_timer_event,
+    };
+    chip->conv_timer = timer_init(&conv_timer_cfg);
+
     chip_reset_state(chip);
-    printf("DS18B20 chip initialised\n");
+    LOGF(LOG_INFO, "DS18B20 chip initialised\n");
+    ow_log_flush(&chip->log);
+    if (recording) {
+        ow_rec_init_done();
+    }
 }
 
 static void chip_reset_state(chip_desc_t *chip) {
@@ -561,22 +757,11 @@ static void chip_reset_state(chip_desc_t *chip) {
     chip->state = ST_INIT_SEQ;
     memset(&chip->cmd_ctx, 0, sizeof(cmd_ctx_t));
 
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
-    memset(chip->buffer, 0, BUF_LEN);
+    chip->tx = (tx_desc_t){0};
 
     // setup scratch pad based on family code
-    switch (chip->serial_no[0]) {
-        default:
-        case DS_FC_18S20:
-            //see  https://www.analog.com/media/en/technical-documentation/data-sheets/ds18s20.pdf (measuring temp)
-            // chip->scratch_pad[CHIP_SP_REMAIN_CNT_OFF] = 0; 
-            chip->scratch_pad[CHIP_SP_CNT_PER_C_OFF] = 16; 
-
-        case DS_FC_18B20:
-            chip->scratch_pad[CHIP_SP_RSVD_1_OFF] = 0xFF; 
-            chip->scratch_pad[CHIP_SP_RSVD_3_OFF] = 0x10; 
-    }
+    FAMILY_OPS(chip)->reset_scratch_pad(chip);
+    update_crc8(chip, CHIP_SP_RSVD_1_OFF);
 }
 
 static void chip_ready_for_next_cmd_byte(chip_desc_t *chip, chip_state_t state, const char *type) {
@@ -587,10 +772,7 @@ static void chip_ready_for_next_cmd_byte(chip_desc_t *chip, chip_state_t state,
     chip->state = state;
     memset(&chip->cmd_ctx, 0, sizeof(cmd_ctx_t));
 
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
-    memset(chip->buffer, 0, BUF_LEN);
-
+    chip->tx = (tx_desc_t){0};
 }
 
 static void chip_ready_for_next_cmd(chip_desc_t *chip) {
@@ -601,34 +783,54 @@ static void chip_ready_for_next_func_cmd(chip_desc_t *chip) {
 }
 
 // ==================== API handlers =========================
-void push_cmd_sm_event(chip_desc_t *chip, sm_t *sm, uint32_t state, uint32_t ev, uint32_t ev_data) {
+static void dispatch_cmd_sm_event(chip_desc_t *chip, sm_t *sm, uint32_t state, uint32_t ev, uint32_t ev_data) {
 
     if (!sm->hash) {
         DEBUGF("%s Initialising hash\n", sm->cfg->name);
         sm_init_hash(sm);
     }
+    ow_trace_record(&chip->trace, sm->cfg, state, ev, ev_data);
 
     uint64_t key = state_event_to_key(state, ev);
     sm_entry_t *e = hashmap_get((sm_entry_map_t *)sm->hash, &key);
 
     if (e == NULL || e->handler == NULL) {
-        DEBUGF("(%s) SM error: unhandled event %d in state %d (e %p)), resetting\n", sm->cfg->name, ev, state, e);
+        LOGF(LOG_WARN, "(%s) SM error: unhandled event %d in state %d (e %p)), resetting\n", sm->cfg->name, ev, state, e);
+        OW_STATS_INC(&chip->stats, unhandled);
+        OW_FAULT(&chip->diag, "unhandled command event");
         chip_reset_state(chip);
         return;
     } else {
         DEBUGF("%s %s[%s]: %s( %d ) -> %p\n",
                sm->cfg->name, e->st_name,
                e->ev_name, e->name, ev_data, e->handler);
+        OW_STATS_TRANS(&chip->stats, sm->cfg, e);
         e->handler(chip, ev_data);
     }
 
-
+    // the next state lookup is only needed for the trace
+    if (!LOG_ON(chip->diag.log_level, LOG_TRACE)) {
+        return;
+    }
     key = state_event_to_key(chip->cmd_ctx.state, ev);
     e = hashmap_get((sm_entry_map_t *)sm->hash, &key);
     const char *n = e != NULL ? e->st_name : "invalid state";
     DEBUGF("(%s) new state -> %s\n", sm->cfg->name, n);
 }
 
+void push_cmd_sm_event(chip_desc_t *chip, sm_t *sm, uint32_t state, uint32_t ev, uint32_t ev_data) {
+    ow_diag_t *d = &chip->diag;
+
+    if (d->filter == NULL) {
+        dispatch_cmd_sm_event(chip, sm, state, ev, ev_data);
+    } else {
+        d->log_level = ow_filter_level(d->filter, d->base_level, sm->cfg);
+        dispatch_cmd_sm_event(chip, sm, state, ev, ev_data);
+        d->log_level = ow_filter_level(d->filter, d->base_level, NULL);
+    }
+    OW_SLOG_SAMPLE(d->slog);
+}
+
 
 // ==================== API handlers =========================
 void on_timer_event(void *data) {
@@ -641,6 +843,7 @@ void on_timer_event(void *data) {
         case TW_TRIANGLE: y = (0.04 * abs((((slot - 25 % 100) + 100) % 100) - 50) - 1) / 2 ; break;
         case TW_SINE:   y = sin(2 * M_PI * chip->temp_chg_freq * slot) / 2; break;
         case TW_SQUARE:   y = slot < 50 ? .5 : -.5; break;
+        case TW_ANALOG:
         case TW_FIXED: y = 0.5;
     }
 
@@ -658,6 +861,22 @@ void on_forced_reset_cb(void *d, uint32_t err, uint32_t data) {
 void on_reset_cb(void *d, uint32_t err, uint32_t data) {
     chip_desc_t *chip = d;
     DEBUGF("on_reset_cb\n");
+    // a reset pulse ends the previous transaction, write out its log before any dumps
+    ow_slog_flush(chip->diag.slog);
+    ow_log_flush(&chip->log);
+    if (chip->diag.filter != NULL) {
+        chip->filter.cmd_active = false;
+        chip->diag.log_level = ow_filter_level(&chip->filter, chip->diag.base_level, NULL);
+    }
+    ow_trace_on_reset_pulse(&chip->trace);
+    ow_stats_on_reset_pulse(&chip->stats);
+    ow_telem_counters(&chip->telem, &chip->stats);
+    ow_telem_flush(&chip->telem);
+    ow_rec_flush();
+    if (chip->log.format == LOG_FMT_BYTES) {
+        uint64_t t = get_sim_nanos();
+        ow_log_printf(&chip->log, "%10" PRIu64 ".%03" PRIu64 " reset\n", t / 1000, t % 1000);
+    }
 
     // reset is done, now wait for master to write command byte, defer to byte SM
     chip_ready_for_next_cmd(chip);
@@ -697,6 +916,8 @@ void on_byte_read_cb(void *d, uint32_t err, uint32_t data) {
     chip_desc_t *chip = d;
 
     DEBUGF("on_master_byte_read_cb\n");
+    chip->stats.bytes_rx++;
+    ow_log_byte(&chip->log, "rx", data);
     // if we're waiting on command code, we handle directly, otherwise the byte is passed to the current command handlers
     if (chip->sig_mode == ST_SIG_BYTE_MODE ) {
         if (chip->state == ST_WAIT_CMD) {
@@ -719,6 +940,8 @@ void on_byte_read_cb(void *d, uint32_t err, uint32_t data) {
 void on_byte_written_cb(void *d, uint32_t err, uint32_t data) {
     chip_desc_t *chip = d;
     DEBUGF("on_byte_written_cb\n");
+    chip->stats.bytes_tx++;
+    ow_log_byte(&chip->log, "tx", data);
     push_cmd_sm_event(chip, chip->cmd_ctx.cmd_sm, chip->cmd_ctx.state, EV_BYTE_WRITTEN, data);
 }
 
@@ -730,6 +953,7 @@ void on_search_bit_written_cb(void *d, uint32_t err, uint32_t data) {
 
     if (err != 0) {
         DEBUGF("write byte: Error occurred while waiting for bit to be read")
+        OW_FAULT(&chip->diag, __func__);
         chip_reset_state(chip);
         return;
     }
@@ -742,6 +966,7 @@ void on_search_bit_read_cb(void *d, uint32_t err, uint32_t data) {
 
     if (err != 0) {
         DEBUGF("write byte: Error occurred while waiting for bit to be read")
+        OW_FAULT(&chip->diag, __func__);
         chip_reset_state(chip);
         return;
     }
@@ -758,6 +983,7 @@ static void on_master_search_error(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
     DEBUGF("on_master_search_error: \n");
+    OW_FAULT(&chip->diag, __func__);
     chip_reset_state(chip);
 }
 
@@ -784,7 +1010,7 @@ static void on_master_search_inv_bit_written(void *user_data, uint32_t data) {
 static void on_master_search_bit_read(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
-    DEBUGF("on_master_search_bit_read: comparing bit %d - m:%d, d:%d\n", chip->byte_ndx * 8 + chip->bit_ndx, data, CUR_BIT(chip))
+    DEBUGF("on_master_search_bit_read: comparing bit %d - m:%d, d:%d\n", chip->tx.byte_ndx * 8 + chip->tx.bit_ndx, data, CUR_BIT(chip))
     // if master transmitted bit does not match ours, reset
     if (data != CUR_BIT(chip))  {
         chip_reset_state(chip);
@@ -793,19 +1019,13 @@ static void on_master_search_bit_read(void *user_data, uint32_t data) {
 
     // if this is an alarm search and the chip did not record it, terminate
     // this is only done after the first bit
-    if (chip->bit_ndx == 0 && chip->rom_command == OW_CMD_ALM_SEARCH && !chip->alarm) {
+    if (chip->tx.bit_ndx == 0 && chip->rom_command == OW_CMD_ALM_SEARCH && !chip->alarm) {
         DEBUGF("on_master_search_bit_read: alarm search terminates since we are not alarmed\n");
         chip_reset_state(chip);
         return;
     }
 
-    chip->bit_ndx++;
-    if (chip->bit_ndx >= 8) {
-        chip->bit_ndx = 0;
-        chip->byte_ndx++;
-    }
-
-    if (chip->byte_ndx == SERIAL_LEN) {
+    if (!tx_next_bit(chip)) {
         DEBUGF("on_master_search_bit_read: *** finished search, going back to init\n");
         chip_reset_state(chip);
         return;
@@ -821,6 +1041,7 @@ static void on_master_write_scratchpad_error(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
     DEBUGF("on_master_write_scratchpad_error: \n");
+    OW_FAULT(&chip->diag, __func__);
     chip_reset_state(chip);
 }
 
@@ -846,19 +1067,11 @@ static void on_master_wr_sp_byte_read(void *user_data, uint32_t data) {
     }
 
     // 3rd byte depends on family code    
-    switch (chip->serial_no[0]) {
-        case DS_FC_18S20:
-            done = chip->cmd_ctx.cmd_data.wr_sp_ctx.byte_ndx >= 2;
-            break;
-
-        case DS_FC_18B20:
-        default:
-            done = chip->cmd_ctx.cmd_data.wr_sp_ctx.byte_ndx >= 3;
-    }
+    done = chip->cmd_ctx.cmd_data.wr_sp_ctx.byte_ndx >= FAMILY_OPS(chip)->wr_sp_len;
 
     if (done)
     {
-        update_crc8(chip);
+        update_crc8(chip, CHIP_SP_USER_BYTE_1_OFF);
         chip_reset_state(chip);
         DEBUGF("on_master_wr_sp_byte_read: *** finished, starting next cycle\n");
     }
@@ -866,19 +1079,19 @@ static void on_master_wr_sp_byte_read(void *user_data, uint32_t data) {
 }
 
 // ------------- Read Byte command SM -----------------
-static void on_master_rd_byte_prime_next_byte(chip_desc_t *chip, int ndx) {
+static void on_master_rd_byte_prime_next_byte(chip_desc_t *chip) {
     ow_ctx_set_master_read_state(chip->ow_ctx, false);
-    ow_write_byte_ctx_reset_state(chip->ow_write_byte_ctx, chip->buffer[ndx]);
+    ow_write_byte_ctx_reset_state(chip->ow_write_byte_ctx, chip->tx.data[chip->tx.byte_ndx]);
 }
 
 static void on_master_rd_byte_byte_written(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
-    chip->cmd_ctx.cmd_data.rd_byte_ctx.byte_ndx++;
-    if (chip->cmd_ctx.cmd_data.rd_byte_ctx.byte_ndx == chip->cmd_ctx.cmd_data.rd_byte_ctx.resp_len) {
+    chip->tx.byte_ndx++;
+    if (chip->tx.byte_ndx == chip->tx.len) {
         DEBUGF("on_master_rd_byte_byte_written: *** finished, starting next cycle\n");
-        for (int i = 0;i < chip->cmd_ctx.cmd_data.rd_byte_ctx.resp_len; i++)
-            DEBUGF("on_master_rd_byte_byte_written: byte %d: %02x\n", i, chip->buffer[i]);
+        for (int i = 0;i < chip->tx.len; i++)
+            DEBUGF("on_master_rd_byte_byte_written: byte %d: %02x\n", i, chip->tx.data[i]);
         
         if (chip->cmd_ctx.cmd_data.rd_byte_ctx.restart_when_done)            
             chip_reset_state(chip);
@@ -888,8 +1101,8 @@ static void on_master_rd_byte_byte_written(void *user_data, uint32_t data) {
         return;
     }
 
-    DEBUGF("on_master_rd_byte_byte_written: writing byte %d = %02x\n", chip->cmd_ctx.cmd_data.rd_byte_ctx.byte_ndx, chip->buffer[chip->cmd_ctx.cmd_data.rd_byte_ctx.byte_ndx]);
-    on_master_rd_byte_prime_next_byte(chip, chip->cmd_ctx.cmd_data.rd_byte_ctx.byte_ndx);
+    DEBUGF("on_master_rd_byte_byte_written: writing byte %d = %02x\n", chip->tx.byte_ndx, chip->tx.data[chip->tx.byte_ndx]);
+    on_master_rd_byte_prime_next_byte(chip);
 }
 
 
@@ -903,26 +1116,21 @@ static void on_master_match_error(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
     DEBUGF("on_master_match_error: \n");
+    OW_FAULT(&chip->diag, __func__);
     chip_reset_state(chip);
 }
 
 static void on_master_match_bit_read(void *user_data, uint32_t data) {
     chip_desc_t *chip = user_data;
 
-    DEBUGF("on_master_match_bit_read: comparing bit %d - m:%d, s:%d\n", chip->byte_ndx * 8 + chip->bit_ndx, data, CUR_BIT(chip))
+    DEBUGF("on_master_match_bit_read: comparing bit %d - m:%d, s:%d\n", chip->tx.byte_ndx * 8 + chip->tx.bit_ndx, data, CUR_BIT(chip))
     // if master transmitted bit does not match ours, reset
     if (data != CUR_BIT(chip))  {
         chip_reset_state(chip);
         return;
     }
 
-    chip->bit_ndx++;
-    if (chip->bit_ndx >= 8) {
-        chip->bit_ndx = 0;
-        chip->byte_ndx++;
-    }
-
-    if (chip->byte_ndx == SERIAL_LEN) {
+    if (!tx_next_bit(chip)) {
         DEBUGF("on_master_match_bit_read: *** finished match, waiting for function command\n");
         chip_ready_for_next_func_cmd(chip);
         return;
@@ -944,7 +1152,12 @@ static void on_master_rd_bit_bit_written(void *user_data, uint32_t data) {
 
 // ==================== Logic Implementation =========================
 static void on_command_word(chip_desc_t *chip, uint8_t cmd, const char *cmd_type_name, chip_state_t st) {
+    if (chip->diag.filter != NULL) {
+        ow_filter_command(&chip->filter, cmd);
+        chip->diag.log_level = ow_filter_level(&chip->filter, chip->diag.base_level, NULL);
+    }
     DEBUGF("on_%s_command %2X\n", cmd_type_name, cmd);
+    chip->stats.cmds[cmd]++;
     uint16_t key = cmd_to_key(st, cmd);
     cmd_entry_t *e = hashmap_get(cmd_map, &key);
     if (e != NULL) {
@@ -952,7 +1165,8 @@ static void on_command_word(chip_desc_t *chip, uint8_t cmd, const char *cmd_type
         return;
     }
 
-    DEBUGF("**** %s command %02x not implemented\n", cmd_type_name, cmd);
+    LOGF(LOG_WARN, "**** %s command %02x not implemented\n", cmd_type_name, cmd);
+    OW_FAULT(&chip->diag, "command not implemented");
     chip_reset_state(chip);
 }
 
@@ -966,15 +1180,19 @@ static void on_func_command(chip_desc_t *chip, uint8_t cmd) {
 }
 
 
+// map the voltage on the TEMP_IN pin linearly onto minTemp..maxTemp
+static float read_analog_temperature(chip_desc_t *chip) {
+    float v = constrain(pin_adc_read(chip->temp_pin), 0.0f, chip->temp_in_vref);
+    return chip->minTemp + (chip->maxTemp - chip->minTemp) * (v / chip->temp_in_vref);
+}
+
 static void set_next_state_based_on_power_mode(chip_desc_t *chip) {
     if (chip->powered) {
         chip->sig_mode = ST_SIG_BIT_MODE;
         chip->state = ST_EXEC_CMD;
         chip->cmd_ctx.state = ST_MASTER_RD_BIT_BIT_WRITTEN;
         chip->cmd_ctx.cmd_sm = sm_wr_bit;
-        chip->bit_ndx = 0;
-        chip->byte_ndx = 0;
-        chip->buffer[0] = chip->powered;
+        tx_start(chip, &tx_bits[chip->powered], 1);
         ds_func_cmd_prime_next_bit(chip);
     } else {
         chip_reset_state(chip);
@@ -985,40 +1203,33 @@ static void set_next_state_based_on_power_mode(chip_desc_t *chip) {
 // we're expecting master to initiate read bit
 static void on_ow_search(chip_desc_t *chip) {
     DEBUGF("on_ow_search\n");
-    memcpy(chip->buffer, chip->serial_no, SERIAL_LEN);
     chip->sig_mode = ST_SIG_BIT_MODE;
     chip->cmd_ctx.state = ST_MASTER_SEARCH_WRITE_BIT;
     chip->cmd_ctx.cmd_sm = sm_search;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
+    tx_start(chip, chip->serial_no, SERIAL_LEN);
 
     ds_func_cmd_prime_next_bit(chip);
-    DEBUGF("on_ow_search started with %s\n", debugBinStr((char *)chip->buffer, SERIAL_LEN));
+    DEBUGF("on_ow_search started with %s\n", debugBinStr((char *)chip->serial_no, SERIAL_LEN));
 }
 
 static void on_ow_read_rom(chip_desc_t *chip) {
     DEBUGF("on_ow_read_rom\n");
-   memcpy(chip->buffer, chip->serial_no, SERIAL_LEN);
 
     chip->state = ST_EXEC_CMD;
     chip->cmd_ctx.state = ST_MASTER_RD_BYTE_BYTE_WRITTEN;
     chip->cmd_ctx.cmd_sm = sm_rd_byte;
     chip->cmd_ctx.cmd_data.rd_byte_ctx.restart_when_done = false;
-    chip->cmd_ctx.cmd_data.rd_byte_ctx.resp_len = SERIAL_LEN;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
+    tx_start(chip, chip->serial_no, SERIAL_LEN);
 
-    on_master_rd_byte_prime_next_byte(chip, 0);
+    on_master_rd_byte_prime_next_byte(chip);
 }
 
 static void on_ow_match(chip_desc_t *chip) {
     DEBUGF("on_ow_match\n");
-    memcpy(chip->buffer, chip->serial_no, SERIAL_LEN);
     chip->sig_mode = ST_SIG_BIT_MODE;
     chip->cmd_ctx.state = ST_MASTER_MATCH_READ_BIT;
     chip->cmd_ctx.cmd_sm = sm_match;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
+    tx_start(chip, chip->serial_no, SERIAL_LEN);
 
     match_start_prime_next_bit(chip);
     DEBUGF("on_ow_match started\n");
@@ -1034,35 +1245,27 @@ static void on_ow_alarm_search(chip_desc_t *chip) {
     on_ow_search(chip);
 }
 
-static void on_ds_convert(chip_desc_t *chip) {
-    DEBUGF("on_ds_convert: scratch pad - : %s\n", debugHexStr(chip->scratch_pad, 9));
-    int16_t tv;
-    int16_t tv_frac;
-    // Allow to set the temperature via GUI
-    if (chip->temp_mode == TW_FIXED) chip->temperature = attr_read_float(chip->temperature_attr);
-    
-    // write our temp into the scratch pad, depending on family code. 
-    switch (chip->serial_no[0]) {
-        case DS_FC_18S20:
-            tv = (int16_t)round(chip->temperature);
-            tv_frac = 12 + 16 *(tv - chip->temperature);
-            DEBUGF("on_ds_convert: DS_FC_18S20 temperature - chip: %f tv: %02x(%d) h7: %02x f: %02x\n", chip->temperature, tv, tv, ((tv & 0x7F) << 1), tv_frac);
-            chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = tv < 0 ? 0xFF : 0;   // if any sign bit is on, value is 0xFF
-            chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = ((tv & 0x7F) << 1) | ((tv_frac & 0x8) ? 1 : 0);  
-            chip->scratch_pad[CHIP_SP_REMAIN_CNT_OFF] = tv_frac;   // update REMAIN_CNT (use 3 or 4 bits?)
-            break;
-
-        case DS_FC_18B20:
-        default: {
-            // the configuration register determines how many significant bits we're using for conversion
-            tv = (16 * chip->temperature);
-            tv_frac =  tv & 0xF;
-            uint16_t mask = 0xFFF0 | (0xF0 >>  (1 + ((chip->scratch_pad[CHIP_SP_CFG_REG_OFF] & CHIP_CFG_TEMP_BITS_MASK) >> CHIP_CFG_TEMP_BITS_OFF)));
-            DEBUGF("on_ds_convert: DS_FC_18B20 temperature - chip: %f tv: %02X, mask:%04x, frac: %x, tv >> 12: %X\n", chip->temperature, tv, mask, tv_frac, tv >> 8);
-            chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = tv >> 8;
-            chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = tv & 0xFF & mask;
-        }
-    }
+// read slots issued by the master while converting return 0, 1 once the conversion is done
+static void ds_start_conv_busy_poll(chip_desc_t *chip) {
+    chip->sig_mode = ST_SIG_BIT_MODE;
+    chip->state = ST_EXEC_CMD;
+    chip->cmd_ctx.state = ST_MASTER_CONV_BUSY_BIT_WRITTEN;
+    chip->cmd_ctx.cmd_sm = sm_conv_busy;
+    tx_start(chip, &tx_bits[!chip->converting], 1);
+    ds_func_cmd_prime_next_bit(chip);
+}
+
+static void on_master_conv_busy_bit_written(void *user_data, uint32_t data) {
+    chip_desc_t *chip = user_data;
+    DEBUGF("on_master_conv_busy_bit_written: %d\n", data);
+
+    // keep answering read slots until the master resets us
+    ds_start_conv_busy_poll(chip);
+}
+
+// write our temp into the scratch pad, depending on family code. 
+static void ds_convert_commit(chip_desc_t *chip) {
+    FAMILY_OPS(chip)->encode_temperature(chip);
 
     // set alarm flag as needed. Since threshold registers are only 7b + S, shift right to remove fractional temp
     char t = (char)chip->temperature;
@@ -1072,18 +1275,53 @@ static void on_ds_convert(chip_desc_t *chip) {
         (char)(chip->scratch_pad[CHIP_SP_USER_BYTE_2_OFF]), (chip->scratch_pad[CHIP_SP_USER_BYTE_2_OFF]), 
     chip->alarm, chip->alarm ? "yes" : "no");
 
-    update_crc8(chip);
-    set_next_state_based_on_power_mode(chip);
+    update_crc8(chip, CHIP_SP_TEMP_LOW_OFF);
     DEBUGF("on_ds_convert: scratch pad - : %s\n", debugHexStr(chip->scratch_pad, 9));
 }
 
+void on_conv_timer_event(void *data) {
+    chip_desc_t *chip = data;
+    DEBUGF("on_conv_timer_event: conversion done\n");
+
+    chip->converting = false;
+    chip->stats.conv_ns += get_sim_nanos() - chip->conv_start;
+    chip->stats.conversions++;
+    ds_convert_commit(chip);
+
+    // if the master is polling between read slots, the next slot reports completion
+    if (chip->cmd_ctx.cmd_sm == sm_conv_busy && chip->ow_ctx->state == ST_MASTER_READ_INIT) {
+        tx_start(chip, &tx_bits[1], 1);
+        ds_func_cmd_prime_next_bit(chip);
+    }
+    OW_SLOG_SAMPLE(chip->diag.slog);
+}
+
+static void on_ds_convert(chip_desc_t *chip) {
+    DEBUGF("on_ds_convert: scratch pad - : %s\n", debugHexStr(chip->scratch_pad, 9));
+
+    // Allow to set the temperature via GUI
+    if (chip->temp_mode == TW_FIXED) chip->temperature = attr_read_float(chip->temperature_attr);
+    if (chip->temp_mode == TW_ANALOG) chip->temperature = read_analog_temperature(chip);
+
+    // a single deadline, the scratch pad is committed when it expires
+    uint32_t conv_time = FAMILY_OPS(chip)->conversion_time_us(chip);
+    chip->converting = true;
+    chip->conv_start = get_sim_nanos();
+    timer_start(chip->conv_timer, conv_time, false);
+    DEBUGF("on_ds_convert: conversion started, %d us\n", conv_time);
+
+    if (chip->powered) {
+        ds_start_conv_busy_poll(chip);
+    } else {
+        chip_reset_state(chip);
+    }
+}
+
 static void on_ds_write_scratchpad(chip_desc_t *chip) {
     DEBUGF("on_ds_write_scratchpad: %s\n", debugHexStr(chip->scratch_pad, 9));
     chip->state = ST_EXEC_CMD;
     chip->cmd_ctx.state = ST_MASTER_WR_SP_BYTE_READ;
     chip->cmd_ctx.cmd_sm = sm_wr_sp;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
 
     ow_ctx_set_master_write_state(chip->ow_ctx, false);
     ow_read_byte_ctx_reset_state(chip->ow_read_byte_ctx);
@@ -1092,32 +1330,19 @@ static void on_ds_write_scratchpad(chip_desc_t *chip) {
 static void on_ds_read_scratchpad(chip_desc_t *chip) {
     DEBUGF("on_ds_read_scratchpad: %s\n", debugHexStr(chip->scratch_pad, 9));
 
-    memcpy(chip->buffer, chip->scratch_pad, SCRATCH_LEN);
     chip->state = ST_EXEC_CMD;
     chip->cmd_ctx.state = ST_MASTER_RD_BYTE_BYTE_WRITTEN;
     chip->cmd_ctx.cmd_sm = sm_rd_byte;
     chip->cmd_ctx.cmd_data.rd_byte_ctx.restart_when_done = true;
-    chip->cmd_ctx.cmd_data.rd_byte_ctx.resp_len = SCRATCH_LEN;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
+    memcpy(chip->tx_scratch_pad, chip->scratch_pad, SCRATCH_LEN);
+    tx_start(chip, chip->tx_scratch_pad, SCRATCH_LEN);
 
-    on_master_rd_byte_prime_next_byte(chip, 0);
+    on_master_rd_byte_prime_next_byte(chip);
 }
 
 static void on_ds_copy_scratchpad(chip_desc_t *chip) {
     // write our temp into the scratch pad. Assume we're in parasitic mode for now
-    chip->eeprom[CHIP_EE_TEMP_HI_OFF] = chip->scratch_pad[CHIP_SP_TEMP_HI_OFF];
-    chip->eeprom[CHIP_EE_TEMP_LOW_OFF] = chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF];
-
-    switch (chip->serial_no[0]) {
-        case DS_FC_18S20:
-            break;
-
-        case DS_FC_18B20:
-        default: {
-            chip->eeprom[CHIP_EE_CFG_REG_OFF] = chip->scratch_pad[CHIP_SP_CFG_REG_OFF];
-        }
-    }
+    FAMILY_OPS(chip)->copy_scratchpad(chip);
 
     set_next_state_based_on_power_mode(chip);
     DEBUGF("on_ds_copy_scratchpad: *** finished, starting next cycle, scratchpad: %s\n", debugHexStr(chip->scratch_pad, 9));
@@ -1125,20 +1350,9 @@ static void on_ds_copy_scratchpad(chip_desc_t *chip) {
 
 static void on_ds_recall(chip_desc_t *chip) {
     DEBUGF("on_ds_recall\n");
-    chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = chip->eeprom[CHIP_EE_TEMP_HI_OFF];
-    chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = chip->eeprom[CHIP_EE_TEMP_LOW_OFF];
-
-    switch (chip->serial_no[0]) {
-        case DS_FC_18S20:
-            break;
-
-        case DS_FC_18B20:
-        default: {
-            chip->scratch_pad[CHIP_SP_CFG_REG_OFF] = chip->eeprom[CHIP_EE_CFG_REG_OFF];
-        }
-    }
+    FAMILY_OPS(chip)->recall(chip);
 
-    update_crc8(chip);
+    update_crc8(chip, CHIP_SP_TEMP_LOW_OFF);
     set_next_state_based_on_power_mode(chip);
     DEBUGF("on_ds_recall started: scratchpad: %s\n", debugHexStr(chip->scratch_pad, 9));
 }
@@ -1148,10 +1362,79 @@ static void on_ds_read_power(chip_desc_t *chip) {
     chip->state = ST_EXEC_CMD;
     chip->cmd_ctx.state = ST_MASTER_RD_BIT_BIT_WRITTEN;
     chip->cmd_ctx.cmd_sm = sm_wr_bit;
-    chip->bit_ndx = 0;
-    chip->byte_ndx = 0;
-    chip->buffer[0] = chip->powered;
+    tx_start(chip, &tx_bits[chip->powered], 1);
 
     ds_func_cmd_prime_next_bit(chip);
     DEBUGF("on_ds_read_power: scratchpad: %s\n", debugHexStr(chip->scratch_pad, 9));
 }
+
+
+// ==================== Family operations =========================
+
+// --- DS18S20, see  https://www.analog.com/media/en/technical-documentation/data-sheets/ds18s20.pdf (measuring temp)
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18S20
+static void ds18s20_reset_scratch_pad(chip_desc_t *chip) {
+    // chip->scratch_pad[CHIP_SP_REMAIN_CNT_OFF] = 0; 
+    chip->scratch_pad[CHIP_SP_RSVD_1_OFF] = 0xFF; 
+    chip->scratch_pad[CHIP_SP_CNT_PER_C_OFF] = 16; 
+}
+
+static void ds18s20_encode_temperature(chip_desc_t *chip) {
+    int16_t tv = (int16_t)round(chip->temperature);
+    int16_t tv_frac = 12 + 16 *(tv - chip->temperature);
+    DEBUGF("on_ds_convert: DS_FC_18S20 temperature - chip: %f tv: %02x(%d) h7: %02x f: %02x\n", chip->temperature, tv, tv, ((tv & 0x7F) << 1), tv_frac);
+    chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = tv < 0 ? 0xFF : 0;   // if any sign bit is on, value is 0xFF
+    chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = ((tv & 0x7F) << 1) | ((tv_frac & 0x8) ? 1 : 0);  
+    chip->scratch_pad[CHIP_SP_REMAIN_CNT_OFF] = tv_frac;   // update REMAIN_CNT (use 3 or 4 bits?)
+}
+
+static uint32_t ds18s20_conversion_time_us(chip_desc_t *chip) {
+    return DS_CONV_TIME_18S20_US;
+}
+
+static void ds18s20_copy_scratchpad(chip_desc_t *chip) {
+    chip->eeprom[CHIP_EE_TEMP_HI_OFF] = chip->scratch_pad[CHIP_SP_TEMP_HI_OFF];
+    chip->eeprom[CHIP_EE_TEMP_LOW_OFF] = chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF];
+}
+
+static void ds18s20_recall(chip_desc_t *chip) {
+    chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = chip->eeprom[CHIP_EE_TEMP_HI_OFF];
+    chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = chip->eeprom[CHIP_EE_TEMP_LOW_OFF];
+}
+#endif
+
+// --- DS18B20 (and compatible families)
+#if !defined(DS_FAMILY) || DS_FAMILY == DS_FC_18B20
+static void ds18b20_reset_scratch_pad(chip_desc_t *chip) {
+    chip->scratch_pad[CHIP_SP_RSVD_1_OFF] = 0xFF; 
+    chip->scratch_pad[CHIP_SP_RSVD_3_OFF] = 0x10; 
+}
+
+static void ds18b20_encode_temperature(chip_desc_t *chip) {
+    // the configuration register determines how many significant bits we're using for conversion
+    int16_t tv = (16 * chip->temperature);
+    int16_t tv_frac =  tv & 0xF;
+    uint16_t mask = 0xFFF0 | (0xF0 >>  (1 + ((chip->scratch_pad[CHIP_SP_CFG_REG_OFF] & CHIP_CFG_TEMP_BITS_MASK) >> CHIP_CFG_TEMP_BITS_OFF)));
+    DEBUGF("on_ds_convert: DS_FC_18B20 temperature - chip: %f tv: %02X, mask:%04x, frac: %x, tv >> 12: %X\n", chip->temperature, tv, mask, tv_frac, tv >> 8);
+    chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = tv >> 8;
+    chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = tv & 0xFF & mask;
+}
+
+// conversion time halves for every bit of resolution dropped
+static uint32_t ds18b20_conversion_time_us(chip_desc_t *chip) {
+    uint8_t res = (chip->scratch_pad[CHIP_SP_CFG_REG_OFF] & CHIP_CFG_TEMP_BITS_MASK) >> CHIP_CFG_TEMP_BITS_OFF;
+    return DS_CONV_TIME_12BIT_US >> (3 - res);
+}
+
+static void ds18b20_copy_scratchpad(chip_desc_t *chip) {
+    chip->eeprom[CHIP_EE_TEMP_HI_OFF] = chip->scratch_pad[CHIP_SP_TEMP_HI_OFF];
+    chip->eeprom[CHIP_EE_TEMP_LOW_OFF] = chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF];
+    chip->eeprom[CHIP_EE_CFG_REG_OFF] = chip->scratch_pad[CHIP_SP_CFG_REG_OFF];
+}
+
+static void ds18b20_recall(chip_desc_t *chip) {
+    chip->scratch_pad[CHIP_SP_TEMP_HI_OFF] = chip->eeprom[CHIP_EE_TEMP_HI_OFF];
+    chip->scratch_pad[CHIP_SP_TEMP_LOW_OFF] = chip->eeprom[CHIP_EE_TEMP_LOW_OFF];
+    chip->scratch_pad[CHIP_SP_CFG_REG_OFF] = chip->eeprom[CHIP_EE_CFG_REG_OFF];
+}
+#endif
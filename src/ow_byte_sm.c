@@ -61,6 +61,7 @@ void ow_read_byte_bit_written_cb(void *d, uint32_t err, uint32_t data) {
 
     if (err != 0) {
         OW_DEBUGF("byte read: Error occurred while waiting for bit to be read")
+        OW_FAULT(&ctx->diag, __func__);
         ow_read_byte_ctx_reset_state(ctx);
         return;
     }
@@ -68,7 +69,7 @@ void ow_read_byte_bit_written_cb(void *d, uint32_t err, uint32_t data) {
     // update state first
     ctx->state = ST_READ_RUNNING;
 
-    sm_push_event(sm_read_byte, ctx, ctx->reset_fn, ctx->state, EV_BIT_WRITTEN, data, ctx->owDebug);
+    sm_push_event(sm_read_byte, ctx, ctx->reset_fn, ctx->state, EV_BIT_WRITTEN, data, &ctx->diag);
 }
 
 
@@ -81,11 +82,7 @@ ow_byte_ctx_t *ow_read_byte_ctx_init(void *data, byte_cb cb, ow_ctx_t *ow_ctx) {
     ctx->user_data = data;
     ctx->reset_fn = ow_read_byte_reset_cb;
     ctx->ow_ctx = ow_ctx;
-
-    uint32_t attr;
-
-    attr = attr_init("owDebug", false);
-    ctx->owDebug = attr_read(attr) != 0;
+    ctx->diag = ow_ctx->diag;
     return ctx;
 }
 void ow_read_byte_ctx_reset_state(ow_byte_ctx_t *ctx) {
@@ -119,6 +116,7 @@ void ow_write_byte_bit_read_cb(void *d, uint32_t err, uint32_t data) {
 
     if (err != 0) {
         OW_DEBUGF("write byte: Error occurred while waiting for bit to be read")
+        OW_FAULT(&ctx->diag, __func__);
         ow_write_byte_ctx_reset_state(ctx, 0);
         return;
     }
@@ -126,7 +124,7 @@ void ow_write_byte_bit_read_cb(void *d, uint32_t err, uint32_t data) {
     // update state first
     ctx->state = ST_WRITE_RUNNING;
 
-    sm_push_event(sm_write_byte, ctx, ctx->reset_fn, ctx->state, EV_BIT_READ, data, ctx->owDebug);
+    sm_push_event(sm_write_byte, ctx, ctx->reset_fn, ctx->state, EV_BIT_READ, data, &ctx->diag);
 }
 
 static void ow_write_byte_reset_cb(void *ctx) { ow_write_byte_ctx_reset_state((ow_byte_ctx_t *) ctx, 0);}
@@ -138,11 +136,7 @@ ow_byte_ctx_t *ow_write_byte_ctx_init(void *data, byte_cb cb, ow_ctx_t *ow_ctx)
     ctx->user_data = data;
     ctx->reset_fn = ow_write_byte_reset_cb;
     ctx->ow_ctx = ow_ctx;
-
-    uint32_t attr;
-
-    attr = attr_init("owDebug", false);
-    ctx->owDebug = attr_read(attr) != 0;
+    ctx->diag = ow_ctx->diag;
     return ctx;
 }
 
@@ -0,0 +1,55 @@
+// Dallas/Maxim 1-Wire CRC8/CRC16, byte wide lookup tables
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include "ow_crc.h"
+
+// The tables are generated by the preprocessor. Both CRCs are linear over GF(2), so the entry
+// for any byte is the XOR of the entries of its set bits. The 8 single bit entries are computed
+// by running the bitwise (reflected) algorithm 8 times, the rest is composed from those.
+#define CRC8_SHIFT(c)   (((c) >> 1) ^ (((c) & 1) * OW_CRC8_POLY))
+#define CRC8_BASIS(b)   CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(CRC8_SHIFT(b))))))))
+#define CRC16_SHIFT(c)  (((c) >> 1) ^ (((c) & 1) * OW_CRC16_POLY))
+#define CRC16_BASIS(b)  CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(CRC16_SHIFT(b))))))))
+
+enum {
+    CRC8_B0 = CRC8_BASIS(0x01), CRC8_B1 = CRC8_BASIS(0x02), CRC8_B2 = CRC8_BASIS(0x04), CRC8_B3 = CRC8_BASIS(0x08),
+    CRC8_B4 = CRC8_BASIS(0x10), CRC8_B5 = CRC8_BASIS(0x20), CRC8_B6 = CRC8_BASIS(0x40), CRC8_B7 = CRC8_BASIS(0x80),
+
+    CRC16_B0 = CRC16_BASIS(0x01), CRC16_B1 = CRC16_BASIS(0x02), CRC16_B2 = CRC16_BASIS(0x04), CRC16_B3 = CRC16_BASIS(0x08),
+    CRC16_B4 = CRC16_BASIS(0x10), CRC16_B5 = CRC16_BASIS(0x20), CRC16_B6 = CRC16_BASIS(0x40), CRC16_B7 = CRC16_BASIS(0x80),
+};
+
+#define BIT_SEL(n, i, v) ((((n) >> (i)) & 1) * (v))
+#define CRC8_E(n)   (BIT_SEL(n, 0, CRC8_B0) ^ BIT_SEL(n, 1, CRC8_B1) ^ BIT_SEL(n, 2, CRC8_B2) ^ BIT_SEL(n, 3, CRC8_B3) ^ \
+                     BIT_SEL(n, 4, CRC8_B4) ^ BIT_SEL(n, 5, CRC8_B5) ^ BIT_SEL(n, 6, CRC8_B6) ^ BIT_SEL(n, 7, CRC8_B7))
+#define CRC16_E(n)  (BIT_SEL(n, 0, CRC16_B0) ^ BIT_SEL(n, 1, CRC16_B1) ^ BIT_SEL(n, 2, CRC16_B2) ^ BIT_SEL(n, 3, CRC16_B3) ^ \
+                     BIT_SEL(n, 4, CRC16_B4) ^ BIT_SEL(n, 5, CRC16_B5) ^ BIT_SEL(n, 6, CRC16_B6) ^ BIT_SEL(n, 7, CRC16_B7))
+
+#define TBL_4(E, n)    E(n), E(n + 1), E(n + 2), E(n + 3)
+#define TBL_16(E, n)   TBL_4(E, n), TBL_4(E, n + 4), TBL_4(E, n + 8), TBL_4(E, n + 12)
+#define TBL_64(E, n)   TBL_16(E, n), TBL_16(E, n + 16), TBL_16(E, n + 32), TBL_16(E, n + 48)
+#define TBL_256(E)     TBL_64(E, 0), TBL_64(E, 64), TBL_64(E, 128), TBL_64(E, 192)
+
+const uint8_t ow_crc8_table[256] = { TBL_256(CRC8_E) };
+const uint16_t ow_crc16_table[256] = { TBL_256(CRC16_E) };
+
+
+uint8_t crc8(const uint8_t *addr, uint8_t len) {
+    return crc8_update(0, addr, len);
+}
+
+uint8_t crc8_update(uint8_t crc, const uint8_t *addr, uint32_t len) {
+    while (len--) {
+        crc = ow_crc8_table[crc ^ *addr++];
+    }
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *input, uint32_t len, uint16_t crc) {
+    while (len--) {
+        crc = crc16_byte(crc, *input++);
+    }
+    return crc;
+}
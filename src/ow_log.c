@@ -0,0 +1,149 @@
+// Per chip log buffer
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_log.h"
+
+#define OW_FILTER_SPEC_LEN 128
+
+void ow_log_init(ow_log_t *l) {
+    char str_attr[10] = {0};
+
+    l->len = 0;
+    l->truncated = 0;
+    l->format = LOG_FMT_DIRECT;
+
+    string_read(attr_string_init("logFormat"), str_attr, sizeof(str_attr));   // direct|buffered|bytes
+    for (int i = 0; str_attr[i]; i++) { str_attr[i] = tolower(str_attr[i]); }
+    if (!strcmp(str_attr, "buffered")) l->format = LOG_FMT_BUFFERED;
+    if (!strcmp(str_attr, "bytes")) l->format = LOG_FMT_BYTES;
+}
+
+static void log_vprintf(ow_log_t *l, const char *fmt, va_list ap) {
+    va_list retry;
+
+    va_copy(retry, ap);
+    int n = vsnprintf(l->buf + l->len, OW_LOG_BUF_LEN - l->len, fmt, ap);
+    if (n >= 0 && l->len + n >= OW_LOG_BUF_LEN) {
+        // does not fit, make room and try again. What still doesn't fit is cut short
+        ow_log_flush(l);
+        n = vsnprintf(l->buf, OW_LOG_BUF_LEN, fmt, retry);
+        if (n >= OW_LOG_BUF_LEN) {
+            n = OW_LOG_BUF_LEN - 1;
+            l->truncated++;
+        }
+    }
+    va_end(retry);
+    if (n > 0) {
+        l->len += n;
+    }
+}
+
+void ow_log_printf(ow_log_t *l, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    if (l == NULL || l->format == LOG_FMT_DIRECT) {
+        vprintf(fmt, ap);
+    } else {
+        log_vprintf(l, fmt, ap);
+    }
+    va_end(ap);
+}
+
+void ow_log_byte(ow_log_t *l, const char *dir, uint8_t b) {
+    if (l == NULL || l->format != LOG_FMT_BYTES) {
+        return;
+    }
+    uint64_t t = get_sim_nanos();
+    ow_log_printf(l, "%10" PRIu64 ".%03" PRIu64 " %s %02X\n", t / 1000, t % 1000, dir, b);
+}
+
+void ow_log_flush(ow_log_t *l) {
+    if (l == NULL || l->len == 0) {
+        return;
+    }
+    fwrite(l->buf, 1, l->len, stdout);
+    fflush(stdout);
+    l->len = 0;
+}
+
+
+static int parse_level(const char *s) {
+    static const char *names[] = {"off", "error", "warn", "info", "trace"};
+    for (int i = LOG_NONE; i <= LOG_TRACE; i++) {
+        if (!strcmp(s, names[i])) return i;
+    }
+    if (!strcmp(s, "none")) return LOG_NONE;
+    if (isdigit((unsigned char)*s) && atoi(s) <= LOG_TRACE) return atoi(s);
+    return -1;
+}
+
+bool ow_filter_init(ow_filter_t *f, struct sm_cfg **cfgs, int n) {
+    char spec[OW_FILTER_SPEC_LEN] = {0};
+
+    memset(f, 0, sizeof(ow_filter_t));
+    string_read(attr_string_init("logFilter"), spec, sizeof(spec));
+    if (!spec[0]) {
+        return false;
+    }
+
+    // ids are needed to build the mask, register the state machines before their hash is built
+    for (int i = 0; i < n; i++) {
+        ow_stats_register(cfgs[i]);
+    }
+
+    for (char *tok = strtok(spec, ","); tok; tok = strtok(NULL, ",")) {
+        char *val = strchr(tok, ':');
+        if (val == NULL) {
+            printf("*** logFilter: expected name:value, got '%s'\n", tok);
+            continue;
+        }
+        *val++ = 0;
+
+        if (!strcmp(tok, "cmd")) {
+            uint8_t cmd = strtol(val, NULL, 0);
+            f->cmds[cmd >> 5] |= 1u << (cmd & 31);
+            f->cmd_filter = true;
+            continue;
+        }
+
+        int level = parse_level(val);
+        int i = 0;
+        while (i < n && strcmp(tok, cfgs[i]->name)) i++;
+        if (i == n || cfgs[i]->id <= 0 || level < 0) {
+            printf("*** logFilter: ignoring '%s:%s'\n", tok, val);
+            continue;
+        }
+        f->sm_set |= 1u << cfgs[i]->id;
+        f->sm_level[cfgs[i]->id] = level;
+    }
+    return true;
+}
+
+void ow_filter_command(ow_filter_t *f, uint8_t cmd) {
+    if (f->cmd_filter) {
+        f->cmd_active |= (f->cmds[cmd >> 5] >> (cmd & 31)) & 1;
+    }
+}
+
+uint8_t ow_filter_level(const ow_filter_t *f, uint8_t base, const struct sm_cfg *cfg) {
+    uint8_t level = base;
+
+    if (cfg != NULL && cfg->id > 0 && (f->sm_set >> cfg->id) & 1) {
+        level = f->sm_level[cfg->id];
+    }
+    if (f->cmd_filter && !f->cmd_active && level > LOG_WARN) {
+        level = LOG_WARN;
+    }
+    return level;
+}
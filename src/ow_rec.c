@@ -0,0 +1,164 @@
+// Host callback recorder - trampolines, record encoding and output
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+
+ow_rec_t ow_rec;
+
+static void put_byte(uint8_t b) {
+    ow_rec.buf[ow_rec.len++] = b;
+}
+
+static void put_varint(uint64_t v) {
+    do {
+        put_byte((v & 0x7F) | (v > 0x7F ? 0x80 : 0));
+        v >>= 7;
+    } while (v);
+}
+
+// make room for a record of up to extra bytes besides the type, delta and value
+static void reserve(uint32_t extra) {
+    if (ow_rec.len + 1 + 10 + 5 + extra > OW_REC_LEN) {
+        ow_rec_flush();
+    }
+}
+
+void ow_rec_flush(void) {
+    if (!ow_rec.on) {
+        return;
+    }
+    static const char digits[] = "0123456789abcdef";
+    char hex[OW_REC_LINE * 2 + 1];
+    for (uint32_t i = 0; i < ow_rec.len; i += OW_REC_LINE) {
+        uint32_t n = 0;
+        for (uint32_t j = i; j < ow_rec.len && j < i + OW_REC_LINE; j++) {
+            hex[n++] = digits[ow_rec.buf[j] >> 4];
+            hex[n++] = digits[ow_rec.buf[j] & 0xF];
+        }
+        hex[n] = 0;
+        printf("~R %u %s\n", ow_rec.seq++, hex);
+    }
+    ow_rec.len = 0;
+}
+
+void ow_rec_put(uint8_t type, uint32_t value) {
+    reserve(0);
+    put_byte(type);
+    put_varint(value);
+}
+
+void ow_rec_put_string(uint32_t len, const char *buf) {
+    uint32_t n = strnlen(buf, len < 255 ? len : 255);
+    reserve(5 + n);
+    put_byte(REC_STRING);
+    put_varint(len);
+    put_varint(n);
+    memcpy(ow_rec.buf + ow_rec.len, buf, n);
+    ow_rec.len += n;
+}
+
+void ow_rec_put_out(pin_t pin, uint32_t write, uint32_t value) {
+    uint8_t idx = 0;
+    while (idx < ow_rec.num_pins && ow_rec.pins[idx] != pin) idx++;
+    ow_rec_put(REC_OUT, REC_OUT_VALUE(idx, write, value));
+}
+
+// callbacks at the top level carry their time, nested ones happen at the time of their parent
+static void put_callback(uint8_t type, uint32_t value) {
+    if (ow_rec.depth > 0) {
+        ow_rec_put(type | REC_NESTED, value);
+        return;
+    }
+    uint64_t now = get_sim_nanos();
+    reserve(0);
+    put_byte(type);
+    put_varint(now - ow_rec.time);
+    put_varint(value);
+    ow_rec.time = now;
+}
+
+bool ow_rec_init(void) {
+    if (ow_rec.on || (attr_read)(attr_init("recordLog", 0)) == 0) {
+        return false;
+    }
+    memset(&ow_rec, 0, sizeof(ow_rec_t));
+    ow_rec.on = true;
+    ow_rec.active = true;
+    put_callback(REC_START, OW_REC_VERSION);
+    return true;
+}
+
+void ow_rec_init_done(void) {
+    ow_rec.active = false;
+}
+
+// ==================== trampolines =========================
+
+static void rec_on_pin_change(void *data, pin_t pin, uint32_t value) {
+    pin_watch_config_t *w = data;
+    put_callback(REC_PIN, (uint32_t)(w - ow_rec.watches) << 1 | (value & 1));
+
+    bool active = ow_rec.active;
+    ow_rec.active = true;
+    ow_rec.depth++;
+    w->pin_change(w->user_data, pin, value);
+    ow_rec.depth--;
+    ow_rec.active = active;
+}
+
+static void rec_on_timer(void *data) {
+    timer_config_t *t = data;
+    put_callback(REC_TIMER, (uint32_t)(t - ow_rec.timers));
+
+    bool active = ow_rec.active;
+    ow_rec.active = true;
+    ow_rec.depth++;
+    t->callback(t->user_data);
+    ow_rec.depth--;
+    ow_rec.active = active;
+}
+
+pin_t ow_rec_pin_init(const char *name, uint32_t mode) {
+    pin_t pin = (pin_init)(name, mode);
+    if (ow_rec.active && ow_rec.num_pins < OW_REC_PINS) {
+        ow_rec.pins[ow_rec.num_pins++] = pin;
+    }
+    return pin;
+}
+
+bool ow_rec_pin_watch(pin_t pin, const pin_watch_config_t *config) {
+    uint8_t idx = 0;
+    while (idx < ow_rec.num_pins && ow_rec.pins[idx] != pin) idx++;
+    if (!ow_rec.active || idx == ow_rec.num_pins) {
+        return (pin_watch)(pin, config);
+    }
+
+    ow_rec.watches[idx] = *config;
+    pin_watch_config_t cfg = *config;
+    cfg.pin_change = rec_on_pin_change;
+    cfg.user_data = &ow_rec.watches[idx];
+    return (pin_watch)(pin, &cfg);
+}
+
+timer_t ow_rec_timer_init(const timer_config_t *config) {
+    if (!ow_rec.active) {
+        return (timer_init)(config);
+    }
+    if (ow_rec.num_timers == OW_REC_TIMERS) {
+        printf("*** recordLog: too many timers, the log can't be replayed\n");
+        return (timer_init)(config);
+    }
+
+    timer_config_t *t = &ow_rec.timers[ow_rec.num_timers++];
+    *t = *config;
+    timer_config_t cfg = *config;
+    cfg.callback = rec_on_timer;
+    cfg.user_data = t;
+    return (timer_init)(&cfg);
+}
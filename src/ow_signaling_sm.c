@@ -141,15 +141,17 @@ void sm_init_hash(sm_t *sm) {
         e->key = state_event_to_key(e->state, e->event);
         hashmap_put(hash, &e->key, e);
     }
+    ow_stats_register(sm->cfg);
 }
 
 
 
 
-void sm_push_event(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, uint32_t event, uint32_t ev_data, bool debug) {
+static void sm_dispatch(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, uint32_t event, uint32_t ev_data, ow_diag_t *diag) {
     if (!sm->hash) {
         sm_init_hash(sm);
     }
+    ow_trace_record(diag->trace, sm->cfg, state, event, ev_data);
 
     uint64_t key = state_event_to_key(state, event);
     sm_entry_t *h = hashmap_get((sm_entry_map_t *)sm->hash, &key);
@@ -157,48 +159,120 @@ void sm_push_event(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, ui
 //    sm_entry_t h = *(sm->sm_entries + sm->max_events * state + event);
 
     if (h == NULL || h->handler == NULL) {
-        _DEBUGF(debug, "SM error: unhandled event %d in state %d, resetting\n", event, state);
+        _LOGF(diag, LOG_WARN, "SM error: unhandled event %d in state %d, resetting\n", event, state);
+        OW_STATS_INC(diag->stats, unhandled);
+        OW_FAULT(diag, "unhandled event");
         reset_fn(ctx);
         return;
-    } else if (h->handler == on_not_impl) {
-        _DEBUGF(debug, "%08lld (%lld) %s[%s]: %s( %d ) - *** not implemented ***\n", get_sim_nanos(), OW_ELAPSED_US(((ow_ctx_t*)ctx)->reset_time),
+    }
+
+    OW_STATS_TRANS(diag->stats, sm->cfg, h);
+    if (h->handler == on_not_impl) {
+        OW_STATS_INC(diag->stats, not_impl);
+        _LOGF(diag, LOG_WARN, "%08" PRIu64 " (%" PRIu64 ") %s[%s]: %s( %d ) - *** not implemented ***\n", get_sim_nanos(), OW_ELAPSED_US(((ow_ctx_t*)ctx)->reset_time),
                 h->st_name, h->ev_name, h->name, ev_data);
     } else {
-                _DEBUGF(debug, "%08lld sm_push_event> (%lld) %s (ctx:%p) %s[%s]: %s( %d ) -> %p\n",
+                _LOGF(diag, LOG_TRACE, "%08" PRIu64 " sm_push_event> (%" PRIu64 ") %s (ctx:%p) %s[%s]: %s( %d ) -> %p\n",
                         get_sim_nanos(),
                         OW_ELAPSED_US(((ow_ctx_t*)ctx)->reset_time), sm->cfg->name, ctx, h->st_name,
                         h->ev_name, h->name, ev_data, h->handler);
                 h->handler(ctx, ev_data);
     }
 
-
+    // the next state lookup is only needed for the trace
+    if (!LOG_ON(diag->log_level, LOG_TRACE)) {
+        return;
+    }
     key = state_event_to_key(((ow_ctx_t*)ctx)->state, event);
     h = hashmap_get((sm_entry_map_t *)sm->hash, &key);
     if (h == NULL) {
-        _DEBUGF(debug, "%08lld sm_push_event< invalid next state\n", get_sim_nanos());
+        _LOGF(diag, LOG_TRACE, "%08" PRIu64 " sm_push_event< invalid next state\n", get_sim_nanos());
     } else {
-        _DEBUGF(debug, "%08lld sm_push_event< %s (ctx: %p) next state=> %s(%d)\n",
+        _LOGF(diag, LOG_TRACE, "%08" PRIu64 " sm_push_event< %s (ctx: %p) next state=> %s(%d)\n",
                 get_sim_nanos(), sm->cfg->name, ctx, h->st_name, h->state);
     }
 }
 
+void sm_push_event(sm_t *sm, void *ctx, reset_state reset_fn, uint32_t state, uint32_t event, uint32_t ev_data, ow_diag_t *diag) {
+    if (diag->filter == NULL) {
+        sm_dispatch(sm, ctx, reset_fn, state, event, ev_data, diag);
+    } else {
+        diag->log_level = ow_filter_level(diag->filter, diag->base_level, sm->cfg);
+        sm_dispatch(sm, ctx, reset_fn, state, event, ev_data, diag);
+        // the handler may have changed the command filter state, go back to the level outside any state machine
+        diag->log_level = ow_filter_level(diag->filter, diag->base_level, NULL);
+    }
+    OW_SLOG_SAMPLE(diag->slog);
+}
+
 
 
 static void on_timer_event(void *data) {
     OW_CTX(data);
     sm_push_event(sm_sig, data, ctx->reset_fn, ctx->state, EV_TIMER_EXPIRED, 0,
-                  ctx->owDebug);
+                  &ctx->diag);
 }
 
 static void on_reset_timer_event(void *data) {
     OW_CTX(data);
-    OW_DEBUGF("%08lld on_reset_timer_event: %d\n", get_sim_nanos(), ctx->reset_detection_timer);
+    OW_DEBUGF("%08" PRIu64 " on_reset_timer_event: %d\n", get_sim_nanos(), ctx->reset_detection_timer);
 
 
     // if the timer expired, last pin change was pulled low meaning there 
     // was no other bus event and the master decided to reset us
     // for now, record this and allow sm to handle this fact
-    sm_push_event(sm_sig, ctx, ((ow_ctx_t *) data)->reset_fn, ((ow_ctx_t *) data)->state, EV_RESET_TIMER_EXPIRED, 0, ctx->owDebug);
+    sm_push_event(sm_sig, ctx, ((ow_ctx_t *) data)->reset_fn, ((ow_ctx_t *) data)->state, EV_RESET_TIMER_EXPIRED, 0, &ctx->diag);
+}
+
+// master timing histograms. Edges are classified by the state they arrive in, before the SM moves on
+static void record_slot_timing(ow_ctx_t *ctx, uint32_t value) {
+    ow_stats_t *s = ctx->diag.stats;
+    uint64_t now = get_sim_nanos();
+
+    if (value == LOW) {
+        switch (ctx->state) {
+            case ST_RESET_INIT: ow_stats_bus_phase(s, BUS_RESET, now); break;
+            case ST_MASTER_WRITE_INIT: ow_stats_bus_phase(s, BUS_WRITE, now); break;
+            case ST_MASTER_READ_INIT: ow_stats_bus_phase(s, BUS_READ, now); break;
+            default: break;
+        }
+        if (ctx->state == ST_MASTER_WRITE_INIT || ctx->state == ST_MASTER_READ_INIT) {
+            if (ctx->last_slot) {
+                ow_hist_add(&s->hist[HIST_RECOVERY], now - ctx->last_rise);
+                ow_hist_add(&s->hist[HIST_SLOT], now - ctx->last_slot);
+            }
+            ctx->last_slot = now;
+        }
+        ctx->last_fall = now;
+        return;
+    }
+
+    ctx->last_rise = now;
+    switch (ctx->state) {
+        case ST_RESET_WAIT_RELEASE:
+            // time slots seen while waiting for a reset are not reset pulses
+            if (now - ctx->last_fall > _NS(PR_DUR_SLOT_MAX)) {
+                ow_hist_add(&s->hist[HIST_RESET], now - ctx->last_fall);
+                ctx->last_slot = 0;
+            }
+            break;
+        case ST_MASTER_WRITE_WAIT_SAMPLE:
+            ow_hist_add(&s->hist[HIST_WRITE_1], now - ctx->last_fall);
+            break;
+        case ST_MASTER_WRITE_SLOT_END:
+        case ST_MASTER_WRITE_DONE:
+            ow_hist_add(&s->hist[HIST_WRITE_0], now - ctx->last_fall);
+            break;
+        case ST_MASTER_READ_WAIT_SAMPLE:
+        case ST_MASTER_READ_DONE:
+            // when sending a 0 we hold the bus, the rising edge is ours
+            if (ctx->bit_buf) {
+                ow_hist_add(&s->hist[HIST_READ_INIT], now - ctx->last_fall);
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 static void on_pin_change(void *data, pin_t pin, uint32_t value) {
@@ -209,18 +283,23 @@ static void on_pin_change(void *data, pin_t pin, uint32_t value) {
         return;
     }
 
+    OW_STATS_INC(ctx->diag.stats, edges);
+    if (ctx->diag.stats) {
+        record_slot_timing(ctx, value);
+    }
     ctx->reset_timer_expired = false;
     timer_stop(ctx->reset_detection_timer);
     if (value == LOW) {
-        OW_DEBUGF("%08lld on_pin_change, starting reset detection timer\n", get_sim_nanos());
+        OW_DEBUGF("%08" PRIu64 " on_pin_change, starting reset detection timer\n", get_sim_nanos());
         timer_start(ctx->reset_detection_timer, PR_DUR_FORCED_RESET, false);
     }
 
-    sm_push_event(sm_sig, ctx, ((ow_ctx_t *) data)->reset_fn, ((ow_ctx_t *) data)->state, EV_PIN_CHG, value, ctx->owDebug);
+    sm_push_event(sm_sig, ctx, ((ow_ctx_t *) data)->reset_fn, ((ow_ctx_t *) data)->state, EV_PIN_CHG, value, &ctx->diag);
 }
 
+// marks a table entry as not implemented. sm_dispatch never calls it, it counts the event in
+// stats.not_impl and logs it at LOG_WARN through the diag of whichever machine it came from
 void on_not_impl(void *ctx, uint32_t data) {
-    printf("not implemented\n");
 }
 
 void on_ignored(void *d, uint32_t data) {
@@ -230,11 +309,14 @@ void on_ignored(void *d, uint32_t data) {
 
 static void on_reset_detected(void *d, uint32_t data) {
     OW_CTX(d);
-    OW_DEBUGF("%08lld on_reset_detected: %d\n", get_sim_nanos(), ctx->reset_detection_timer);
+    OW_DEBUGF("%08" PRIu64 " on_reset_detected: %d\n", get_sim_nanos(), ctx->reset_detection_timer);
 
 
     // reset our and owner's context and then set the state as if we're waiting for the reset 
     // pin change from LOW to HIGH. The normal timer is not started.
+    OW_STATS_INC(ctx->diag.stats, forced_resets);
+    // the bus has been low since the last falling edge, which started what looked like a slot
+    ow_stats_bus_phase(ctx->diag.stats, BUS_RESET, ctx->last_fall);
     ctx->forced_reset_callback(ctx->user_data, OW_ERR_NO_ERROR, 0);
     ow_ctx_reset_state(ctx);
     ctx->state = ST_RESET_WAIT_RELEASE;
@@ -242,6 +324,17 @@ static void on_reset_detected(void *d, uint32_t data) {
 
 // ==================== Implementation =========================
 static void ow_ctx_reset_cb(void *ctx) { ow_ctx_reset_state((ow_ctx_t *)ctx);}
+
+// a timing attribute, clamped to lo - hi so the slot arithmetic can't go negative
+static uint32_t attr_read_timing(ow_ctx_t *ctx, const char *name, uint32_t def, uint32_t lo, uint32_t hi) {
+    uint32_t v = attr_read(attr_init(name, def));
+    if (v < lo || v > hi) {
+        OW_LOGF(LOG_WARN, "%s %u is outside %u - %u, using %u\n", name, v, lo, hi, v < lo ? lo : hi);
+        v = v < lo ? lo : hi;
+    }
+    return v;
+}
+
 ow_ctx_t * ow_ctx_init(ow_ctx_cfg_t *cfg)  {
     ow_ctx_t *ctx = calloc(1, sizeof(ow_ctx_t));
     ctx->user_data = cfg->data;
@@ -251,6 +344,10 @@ ow_ctx_t * ow_ctx_init(ow_ctx_cfg_t *cfg)  {
     ctx->bit_written_callback = cfg->bit_written_cb;
 
     ctx->reset_fn = ow_ctx_reset_cb;
+    ctx->diag.trace = cfg->trace;
+    ctx->diag.stats = cfg->stats;
+    ctx->diag.log = cfg->log;
+    ctx->diag.slog = cfg->slog;
 
     timer_config_t timer_cfg = {
             .user_data = ctx
@@ -272,32 +369,57 @@ ow_ctx_t * ow_ctx_init(ow_ctx_cfg_t *cfg)  {
 
 
     // read config attributes
-    uint32_t attr;
-
-    attr = attr_init("owDebug", false);
-    ctx->owDebug = attr_read(attr) != 0;
+    ctx->diag.base_level = ctx->diag.log_level = ow_log_level_init("owDebug");
+    ctx->diag.filter = cfg->filter;
+    if (ctx->diag.filter != NULL) {
+        ctx->diag.log_level = ow_filter_level(ctx->diag.filter, ctx->diag.base_level, NULL);
+    }
 
-//    attr = attr_init("presence_wait_time", PR_DUR_WAIT_PRESENCE);
-//    ctx->presence_wait_time = attr_read(attr);
-//    attr = attr_init("presence_time", PR_DUR_PULL_PRESENCE);
-//    ctx->presence_time = attr_read(attr);
+    // slave side timing, the defaults are the datasheet's. The reset slot ends 1us before the
+    // nominal end of the reset cycle whatever the presence timing, so the presence pulse has to
+    // end before that. Sampling and the read hold have to fall inside the shortest slot, after
+    // the 1us the read slot starts with, and a jitter past the longest slot would take slots
+    // for resets
+    ctx->presence_wait_time = attr_read_timing(ctx, "presenceWait", PR_DUR_RESET_MASTER_RELEASE, 1, PR_DUR_RESET - 3);
+    ctx->presence_time = attr_read_timing(ctx, "presenceTime", PR_DUR_RESET_PULL_PRESENCE, 1,
+                                          PR_DUR_RESET - 2 - ctx->presence_wait_time);
+    uint32_t presence_end = ctx->presence_wait_time + ctx->presence_time;
+    ctx->reset_slot_end = PR_DUR_RESET - 1 - presence_end;
+    ctx->sample_wait_time = attr_read_timing(ctx, "sampleWait", PR_DUR_SAMPLE_WAIT, 1, PR_DUR_SLOT - 1);
+    ctx->read_hold_time = attr_read_timing(ctx, "readHold", PR_DUR_READ_SLOT, PR_DUR_READ_INIT + 1, PR_DUR_SLOT - 1);
+    ctx->bus_jitter = attr_read_timing(ctx, "busJitter", PR_DUR_BUS_JITTER, 0, _NS(PR_DUR_RESET - PR_DUR_SLOT_MAX));
 
 
     ow_ctx_reset_state(ctx);
-    OW_DEBUGF("%08lld ow_ctx_init\n", get_sim_nanos());
+    OW_DEBUGF("%08" PRIu64 " ow_ctx_init\n", get_sim_nanos());
 
     return ctx;
 }
 
+// runtime log level from the `logLevel` attribute, the given debug attribute forces tracing on
+uint8_t ow_log_level_init(const char *trace_attr) {
+    uint8_t level = attr_read(attr_init("logLevel", LOG_INFO));
+    if (attr_read(attr_init(trace_attr, false))) {
+        level = LOG_TRACE;
+    }
+    return level;
+}
+
 
 void ow_ctx_reset_state(ow_ctx_t *ctx) {
     OW_DEBUGF("ow_ctx: resetting state from %s\n", ST_NAME(sm_sig_entries))
+    if (ctx->diag.trace && ctx->diag.trace->fault) {
+        // keep the log ahead of the fault dump
+        ow_log_flush(ctx->diag.log);
+    }
+    ow_trace_on_state_reset(ctx->diag.trace);
     ctx->state = ST_RESET_INIT;
     ctx->cur_sm = sm_sig;
     ctx->reset_time = 0;
     ctx->reset_timer_expired = false;
 
     ctx->slot_start = 0;
+    ctx->last_slot = 0;
 
     pin_mode(ctx->pin, INPUT_PULLUP);
 
@@ -343,17 +465,25 @@ static void on_reset_wait_release_pin_chg(void *d, uint32_t data) {
 
     timer_stop(ctx->timer);
 
+    // a time slot of a transaction this chip is not part of (deselected by a search or match ROM),
+    // keep waiting for the next reset
+    if (OW_ELAPSED(ctx->reset_time) <= _NS(PR_DUR_SLOT_MAX)) {
+        ow_ctx_reset_state(ctx);
+        return;
+    }
+
     // if pin changed before the expected duration, log and reset
     // note: no need to notify owner, since we're still waiting for reset
-    if (TOO_EARLY((ctx->reset_time), _NS(PR_DUR_RESET), PR_DUR_BUS_JITTER)) {
-        OW_DEBUGF("L->H transition happened too soon, (%lld) - resetting\n", _US(OW_ELAPSED(ctx->reset_time)));
+    if (TOO_EARLY((ctx->reset_time), _NS(PR_DUR_RESET), ctx->bus_jitter)) {
+        OW_DEBUGF("L->H transition happened too soon, (%" PRIu64 ") - resetting\n", _US(OW_ELAPSED(ctx->reset_time)));
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
 
     // move to wait for bus to 'stabilise'
     ctx->state = ST_RESET_WAIT_PRESENCE;
-    timer_start(ctx->timer, PR_DUR_RESET_MASTER_RELEASE, false);
+    timer_start(ctx->timer, ctx->presence_wait_time, false);
 }
 
 static void on_reset_wait_release_timer_expired(void *d, uint32_t data) {
@@ -375,7 +505,7 @@ static void on_reset_wait_presence_timer_expired(void *d, uint32_t data) {
     // timer_start(ctx->timer, ctx->presence_wait_time, false);
     ctx->state = ST_RESET_PULL_PRESENCE;
     pin_mode(ctx->pin, OUTPUT_LOW);
-    timer_start(ctx->timer, PR_DUR_RESET_PULL_PRESENCE, false);
+    timer_start(ctx->timer, ctx->presence_time, false);
 }
 
 
@@ -392,7 +522,7 @@ static void on_reset_pull_presence_timer_expired(void *d, uint32_t data) {
     // release the bus and wait for master next write (bits)
     pin_mode(ctx->pin, INPUT_PULLUP);
     ctx->state = ST_RESET_DONE;
-    timer_start(ctx->timer, PR_DUR_RESET_SLOT_END, false);
+    timer_start(ctx->timer, ctx->reset_slot_end, false);
 }
 
 
@@ -401,13 +531,20 @@ static void on_reset_done_pin_chg(void *d, uint32_t data) {
     // unexpected transition, reset
     if (data == LOW) {
         OW_DEBUGF("H->L transition unexpected when in done state, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
 
+    // the bus is released once the last device on it ends its presence pulse, which may be after
+    // ours. The slot end timer is not needed any more
+    timer_stop(ctx->timer);
+
     // after reset is done, the master will write the next command.
     // set the state accordingly, but allow the callback to override if desired
     ctx->state = ST_MASTER_WRITE_INIT;
+    OW_STATS_INC(ctx->diag.stats, resets);
+    ow_stats_bus_phase(ctx->diag.stats, BUS_IDLE, get_sim_nanos());
     ctx->reset_callback(ctx->user_data, OW_ERR_NO_ERROR, 0);
 }
 
@@ -418,6 +555,8 @@ static void on_reset_done_timer_expired(void *d, uint32_t data) {
     // after reset is done, the master will write the next command.
     // set the state accordingly, but allow the callback to override if desired
     ctx->state = ST_MASTER_WRITE_INIT;
+    OW_STATS_INC(ctx->diag.stats, resets);
+    ow_stats_bus_phase(ctx->diag.stats, BUS_IDLE, get_sim_nanos());
     ctx->reset_callback(ctx->user_data, OW_ERR_NO_ERROR, 0);
 }
 
@@ -430,12 +569,13 @@ static void on_master_write_init_pin_chg(void *d, uint32_t data) {
 
     if (data == HIGH) {
         OW_DEBUGF("L->H transition unexpected while waiting for initial pull down during write time slot, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
     ctx->state = ST_MASTER_WRITE_WAIT_SAMPLE;
     ctx->slot_start = get_sim_nanos();
-    timer_start(ctx->timer, PR_DUR_SAMPLE_WAIT, false);
+    timer_start(ctx->timer, ctx->sample_wait_time, false);
 }
 
 static void on_master_write_wait_sample_pin_chg(void *d, uint32_t data) {
@@ -444,6 +584,7 @@ static void on_master_write_wait_sample_pin_chg(void *d, uint32_t data) {
     // todo(bonnyr): this needs to be confirmed as unexpected
     if (data == LOW) {
         OW_DEBUGF("H->L transition unexpected while waiting for bus release during write time slot, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
@@ -480,6 +621,8 @@ static void on_master_write_wait_slot_end_timer_expired(void *d, uint32_t data)
         return;
     }
     ctx->state = ST_MASTER_WRITE_INIT;
+    OW_STATS_INC(ctx->diag.stats, write_slots);
+    ow_stats_bus_phase(ctx->diag.stats, BUS_IDLE, get_sim_nanos());
     ctx->bit_read_callback(ctx->user_data, OW_ERR_NO_ERROR, ctx->bit_buf);
     OW_DEBUGF("on_master_write_wait_slot_end_timer_expired: ctx: %p, ctx->state after callback %d (was set by us to %d)\n", ctx, ctx->state, ST_MASTER_WRITE_INIT);
 }
@@ -495,6 +638,8 @@ static void on_master_write_done_pin_chg(void *d, uint32_t data) {
     }
 
     ctx->state = ST_MASTER_WRITE_INIT;
+    OW_STATS_INC(ctx->diag.stats, write_slots);
+    ow_stats_bus_phase(ctx->diag.stats, BUS_IDLE, get_sim_nanos());
     ctx->bit_read_callback(ctx->user_data, OW_ERR_NO_ERROR, ctx->bit_buf);
     OW_DEBUGF("on_master_write_done_pin_chg: ctx->state after callback %d (was set by us to %d)\n", ST_MASTER_WRITE_INIT, ctx->state);
 
@@ -511,6 +656,7 @@ static void on_master_read_init_pin_chg(void *d, uint32_t data) {
 
     if (data == HIGH) {
         OW_DEBUGF("L->H transition unexpected while waiting for initial pull down during write time slot, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
@@ -527,7 +673,9 @@ static void write_next_bit(ow_ctx_t *ctx) {
     if (!ctx->bit_buf) {
         pin_mode(ctx->pin, OUTPUT_LOW);
 
-        timer_start(ctx->timer, PR_DUR_READ_SLOT - OW_ELAPSED_US(ctx->slot_start), false);
+        // hold for what is left of the read hold time, none if the slot got there first
+        uint64_t elapsed = OW_ELAPSED_US(ctx->slot_start);
+        timer_start(ctx->timer, elapsed < ctx->read_hold_time ? ctx->read_hold_time - elapsed : 0, false);
         ctx->state = ST_MASTER_READ_SLOT_END;
     } else {
         ctx->state = ST_MASTER_READ_DONE;
@@ -541,6 +689,7 @@ static void on_master_read_wait_sample_pin_chg(void *d, uint32_t data) {
     // todo(bonnyr): this needs to be confirmed as unexpected
     if (data == LOW) {
         OW_DEBUGF("H->L transition unexpected while waiting for bus release during write time slot, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
@@ -563,6 +712,7 @@ static void on_master_read_slot_end_pin_chg(void *d, uint32_t data) {
     // todo(bonnyr): this needs to be confirmed as unexpected
     if (data == HIGH && !ctx->bit_buf || data == LOW && ctx->bit_buf) {
         OW_DEBUGF("L->H or H->L transition unexpected while waiting for READ slot timer, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
@@ -584,10 +734,13 @@ static void on_master_read_done_pin_chg(void *d, uint32_t data) {
 
     if (data == LOW) {
         OW_DEBUGF("H->L transition unexpected while waiting for READ slot bus release, resetting\n");
+        OW_FAULT(&ctx->diag, __func__);
         ow_ctx_reset_state(ctx);
         return;
     }
 
     ctx->state = ST_MASTER_READ_INIT;
+    OW_STATS_INC(ctx->diag.stats, read_slots);
+    ow_stats_bus_phase(ctx->diag.stats, BUS_IDLE, get_sim_nanos());
     ctx->bit_written_callback(ctx->user_data, OW_ERR_NO_ERROR, ctx->bit_buf);
 }
@@ -0,0 +1,63 @@
+// State log - change detection and output
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_slog.h"
+
+bool ow_slog_init(ow_slog_t *l, ow_log_t *log) {
+    memset(l, 0, sizeof(ow_slog_t));
+    l->log = log;
+    return attr_read(attr_init("stateLog", 0)) != 0;
+}
+
+static uint32_t wire_read(const ow_slog_wire_t *w) {
+    return w->size == 1 ? *(const uint8_t *)w->p : *(const uint32_t *)w->p;
+}
+
+void ow_slog_watch(ow_slog_t *l, const char *name, const void *p, uint8_t size, uint8_t bits) {
+    if (l->num_wires == OW_SLOG_WIRES) {
+        printf("*** stateLog: no room for %s\n", name);
+        return;
+    }
+    uint8_t id = l->num_wires++;
+    ow_slog_wire_t *w = &l->wires[id];
+    w->name = name;
+    w->p = p;
+    w->size = size;
+    w->bits = bits;
+    w->last = wire_read(w);
+
+    ow_log_printf(l->log, "~W %u %u %s\n", id, bits, name);
+    l->rec[l->len++] = (ow_slog_rec_t){get_sim_nanos(), id, w->last};
+}
+
+void ow_slog_sample(ow_slog_t *l) {
+    for (uint8_t i = 0; i < l->num_wires; i++) {
+        ow_slog_wire_t *w = &l->wires[i];
+        uint32_t v = wire_read(w);
+        if (v == w->last) {
+            continue;
+        }
+        w->last = v;
+        if (l->len == OW_SLOG_LEN) {
+            ow_slog_flush(l);
+        }
+        l->rec[l->len++] = (ow_slog_rec_t){get_sim_nanos(), i, v};
+    }
+}
+
+void ow_slog_flush(ow_slog_t *l) {
+    if (l == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < l->len; i++) {
+        ow_log_printf(l->log, "~S %" PRIu64 " %u %u\n", l->rec[i].time, l->rec[i].wire, l->rec[i].value);
+    }
+    l->len = 0;
+}
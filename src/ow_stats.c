@@ -0,0 +1,228 @@
+// Hot path counters - state machine registry and dump
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_stats.h"
+#include "ow_telem.h"
+
+// state machine configs are global, so is their layout in the per chip transition counters
+static sm_cfg_t *sm_registry[OW_STATS_MAX_SM];
+static int sm_registry_len;
+static int trans_len;
+
+// histogram defaults, bins can be changed with the `slotHistBins` attribute
+static const struct {
+    const char *name;
+    uint32_t lo_us, width_us, spec_min_us, spec_max_us;
+} hist_defs[HIST_MAX] = {
+    [HIST_RESET]     = {"reset", 400, 40, PR_DUR_RESET, PR_DUR_RESET_MAX},
+    [HIST_RECOVERY]  = {"rec", 0, 2, PR_DUR_RECOVERY, 0},
+    [HIST_WRITE_0]   = {"w0", 50, 5, PR_DUR_SLOT, PR_DUR_SLOT_MAX},
+    [HIST_WRITE_1]   = {"w1", 0, 1, PR_DUR_READ_INIT, PR_DUR_SAMPLE_WAIT},
+    [HIST_READ_INIT] = {"rinit", 0, 1, PR_DUR_READ_INIT, PR_DUR_READ_SLOT},
+    [HIST_SLOT]      = {"slot", 50, 5, PR_DUR_SLOT + PR_DUR_RECOVERY, 0},
+};
+
+typedef struct {
+    uint32_t count;
+    const sm_cfg_t *cfg;
+    const sm_entry_t *e;
+} trans_count_t;
+
+// parse a comma separated list of name:lo:width (us), e.g. "reset:450:20,w1:0:2"
+static void hist_parse_bins(ow_stats_t *s, char *spec) {
+    for (char *tok = strtok(spec, ","); tok; tok = strtok(NULL, ",")) {
+        char *lo = strchr(tok, ':');
+        char *width = lo ? strchr(lo + 1, ':') : NULL;
+        if (width == NULL) {
+            printf("*** slotHistBins: expected name:lo:width, got '%s'\n", tok);
+            continue;
+        }
+        *lo++ = 0;
+        *width++ = 0;
+
+        int i = 0;
+        while (i < HIST_MAX && strcmp(tok, hist_defs[i].name)) i++;
+        if (i == HIST_MAX || atoi(width) <= 0) {
+            printf("*** slotHistBins: bad histogram '%s'\n", tok);
+            continue;
+        }
+        s->hist[i].lo_ns = _NS(atoi(lo));
+        s->hist[i].width_ns = _NS(atoi(width));
+    }
+}
+
+void ow_stats_init(ow_stats_t *s) {
+    char spec[128] = {0};
+
+    memset(s, 0, sizeof(ow_stats_t));
+    s->dump_attr = attr_init("statsDump", STATS_DUMP_OFF);
+
+    for (int i = 0; i < HIST_MAX; i++) {
+        ow_hist_t *h = &s->hist[i];
+        h->lo_ns = _NS(hist_defs[i].lo_us);
+        h->width_ns = _NS(hist_defs[i].width_us);
+        h->spec_min_ns = _NS(hist_defs[i].spec_min_us);
+        h->spec_max_ns = _NS(hist_defs[i].spec_max_us);
+        h->min_ns = UINT32_MAX;
+    }
+    s->start_ns = s->phase_start_ns = get_sim_nanos();
+    s->bus_phase = BUS_IDLE;
+    string_read(attr_string_init("slotHistBins"), spec, sizeof(spec));
+    hist_parse_bins(s, spec);
+}
+
+void ow_hist_add(ow_hist_t *h, uint64_t ns) {
+    uint32_t v = ns > UINT32_MAX ? UINT32_MAX : ns;
+    int bin = v < h->lo_ns ? 0 : 1 + (v - h->lo_ns) / h->width_ns;
+
+    h->bins[bin > OW_HIST_BINS ? OW_HIST_BINS + 1 : bin]++;
+    h->count++;
+    h->sum_ns += v;
+    if (v < h->min_ns) h->min_ns = v;
+    if (v > h->max_ns) h->max_ns = v;
+    if (v < h->spec_min_ns || (h->spec_max_ns && v > h->spec_max_ns)) h->out_of_spec++;
+}
+
+void ow_stats_bus_phase(ow_stats_t *s, ow_bus_phase_t phase, uint64_t now) {
+    if (s == NULL || phase == s->bus_phase) {
+        return;
+    }
+    uint64_t d = now > s->phase_start_ns ? now - s->phase_start_ns : 0;
+    s->bus_ns[s->bus_phase] += d;
+
+    bool slot = phase == BUS_WRITE || phase == BUS_READ;
+    if (s->bus_phase == BUS_IDLE && s->after_slot && slot) {
+        s->idle_gap_ns += d;
+        s->idle_gaps++;
+    }
+    if (s->bus_phase != BUS_IDLE) {
+        s->after_slot = s->bus_phase == BUS_WRITE || s->bus_phase == BUS_READ;
+    }
+    s->bus_phase = phase;
+    s->phase_start_ns = now;
+}
+
+static void bus_dump(const ow_stats_t *s) {
+    static const char *names[BUS_MAX] = {"idle", "reset", "write", "read"};
+    uint64_t now = get_sim_nanos();
+    uint64_t bus_ns[BUS_MAX];
+    double elapsed = now - s->start_ns;
+
+    if (elapsed <= 0) {
+        return;
+    }
+    memcpy(bus_ns, s->bus_ns, sizeof(bus_ns));
+    bus_ns[s->bus_phase] += now - s->phase_start_ns;
+
+    printf("  bus (%.3f ms):\n   ", elapsed / 1e6);
+    for (int i = 0; i < BUS_MAX; i++) {
+        printf(" %s: %.1f%%", names[i], 100.0 * bus_ns[i] / elapsed);
+    }
+    printf(", converting: %.1f%% (%u conversions)\n", 100.0 * s->conv_ns / elapsed, s->conversions);
+    printf("    %.1f bytes/s (rx: %u, tx: %u), %.1f bits/s, %.2f transactions/s, avg idle gap: %.3f us\n",
+           (s->bytes_rx + s->bytes_tx) * 1e9 / elapsed, s->bytes_rx, s->bytes_tx,
+           (s->write_slots + s->read_slots) * 1e9 / elapsed, s->resets * 1e9 / elapsed,
+           s->idle_gaps ? s->idle_gap_ns / 1e3 / s->idle_gaps : 0.0);
+}
+
+static void hist_dump(const char *name, const ow_hist_t *h) {
+    if (h->count == 0) {
+        return;
+    }
+    printf("    %-6s n: %u, min: %.3f, avg: %.3f, max: %.3f us, out of spec: %u (spec %u..%u us)\n", name, h->count,
+           h->min_ns / 1e3, h->sum_ns / 1e3 / h->count, h->max_ns / 1e3, h->out_of_spec,
+           h->spec_min_ns / 1000, h->spec_max_ns / 1000);
+    for (int i = 0; i < OW_HIST_BINS + 2; i++) {
+        if (h->bins[i] == 0) continue;
+        if (i == 0) {
+            printf("      %9s < %-6u %u\n", "", h->lo_ns / 1000, h->bins[i]);
+        } else if (i == OW_HIST_BINS + 1) {
+            printf("      %9s >= %-5u %u\n", "", (h->lo_ns + OW_HIST_BINS * h->width_ns) / 1000, h->bins[i]);
+        } else {
+            uint32_t lo = h->lo_ns + (i - 1) * h->width_ns;
+            printf("      %6u .. %-6u %u\n", lo / 1000, (lo + h->width_ns) / 1000, h->bins[i]);
+        }
+    }
+}
+
+void ow_stats_register(sm_cfg_t *cfg) {
+    if (cfg->id != 0) {
+        return;
+    }
+    if (sm_registry_len == OW_STATS_MAX_SM || trans_len + cfg->num_entries > OW_STATS_MAX_TRANS) {
+        printf("*** stats: no room for %s transitions, not counted\n", cfg->name);
+        cfg->stats_base = -1;
+        cfg->id = -1;
+        return;
+    }
+    cfg->stats_base = trans_len;
+    trans_len += cfg->num_entries;
+    sm_registry[sm_registry_len++] = cfg;
+    cfg->id = sm_registry_len;
+}
+
+static int trans_count_cmp(const void *a, const void *b) {
+    const trans_count_t *ta = a, *tb = b;
+    return ta->count < tb->count ? 1 : ta->count > tb->count ? -1 : 0;
+}
+
+void ow_stats_dump(ow_stats_t *s) {
+    if (s->telem != NULL) {
+        ow_telem_counters(s->telem, s);
+        for (int i = 0; i < HIST_MAX; i++) {
+            if (s->hist[i].count) ow_telem_hist(s->telem, i, &s->hist[i]);
+        }
+        return;
+    }
+    printf("*** stats: edges: %u, resets: %u (forced: %u), write slots: %u, read slots: %u\n"
+           "    not implemented: %u, unhandled: %u, errors: %u, crc updates: %u\n",
+           s->edges, s->resets, s->forced_resets, s->write_slots, s->read_slots,
+           s->not_impl, s->unhandled, s->errors, s->crc_updates);
+
+    printf("  commands:\n");
+    for (int i = 0; i < 256; i++) {
+        if (s->cmds[i]) printf("    %02X: %u\n", i, s->cmds[i]);
+    }
+
+    // transitions, most frequent first
+    trans_count_t tc[OW_STATS_MAX_TRANS];
+    int n = 0;
+    for (int i = 0; i < sm_registry_len; i++) {
+        const sm_cfg_t *cfg = sm_registry[i];
+        for (int j = 0; j < cfg->num_entries; j++) {
+            uint32_t c = s->trans[cfg->stats_base + j];
+            if (c) tc[n++] = (trans_count_t){c, cfg, &cfg->sm_entries[j]};
+        }
+    }
+    qsort(tc, n, sizeof(trans_count_t), trans_count_cmp);
+
+    printf("  transitions:\n");
+    for (int i = 0; i < n; i++) {
+        printf("    %10u %-16s %s[%s]: %s\n", tc[i].count, tc[i].cfg->name, tc[i].e->st_name, tc[i].e->ev_name, tc[i].e->name);
+    }
+
+    bus_dump(s);
+
+    printf("  master timing:\n");
+    for (int i = 0; i < HIST_MAX; i++) {
+        hist_dump(hist_defs[i].name, &s->hist[i]);
+    }
+}
+
+void ow_stats_on_reset_pulse(ow_stats_t *s) {
+    if (s == NULL) {
+        return;
+    }
+    uint32_t v = attr_read(s->dump_attr);
+    if (v == STATS_DUMP_EVERY_RESET || (v == STATS_DUMP_ONCE && s->dump_last != v)) {
+        ow_stats_dump(s);
+    }
+    s->dump_last = v;
+}
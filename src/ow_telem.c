@@ -0,0 +1,178 @@
+// Binary telemetry - frame encoding and UART output
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_crc.h"
+#include "ow_telem.h"
+
+#define FRAME_OVERHEAD  6       // sync, type, len, crc
+#define TRACE_REC_LEN   13
+#define ROM_ID_LEN      8
+
+static void on_write_done(void *user_data) {
+    ow_telem_t *t = user_data;
+    t->busy = false;
+}
+
+// reserve a frame with room for len payload bytes, returns the payload or NULL if it doesn't fit
+static uint8_t *frame_begin(ow_telem_t *t, uint8_t type, uint32_t len) {
+    if (!t->enabled) {
+        return NULL;
+    }
+    if (t->len + FRAME_OVERHEAD + len > OW_TELEM_BUF_LEN) {
+        t->dropped++;
+        return NULL;
+    }
+    uint8_t *f = t->buf[t->active] + t->len;
+    f[0] = OW_TELEM_SYNC;
+    f[1] = type;
+    f[2] = len;
+    f[3] = len >> 8;
+    return f + 4;
+}
+
+static void frame_end(ow_telem_t *t) {
+    uint8_t *f = t->buf[t->active] + t->len;
+    uint32_t len = f[2] | f[3] << 8;
+    uint16_t crc = crc16(f + 1, len + 3, 0);
+
+    f[4 + len] = crc;
+    f[5 + len] = crc >> 8;
+    t->len += FRAME_OVERHEAD + len;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return p + 4;
+}
+
+static uint8_t *put64(uint8_t *p, uint64_t v) {
+    return put32(put32(p, v), v >> 32);
+}
+
+bool ow_telem_init(ow_telem_t *t, const uint8_t *rom_id) {
+    memset(t, 0, sizeof(ow_telem_t));
+    uint32_t baud = attr_read(attr_init("telemBaud", 0));
+    if (baud == 0) {
+        return false;
+    }
+
+    const uart_config_t cfg = {
+            .user_data = t,
+            .rx = NO_PIN,
+            .tx = pin_init("TELEM", INPUT_PULLUP),
+            .baud_rate = baud,
+            .write_done = on_write_done,
+    };
+    t->uart = uart_init(&cfg);
+    t->enabled = true;
+
+    uint8_t *p = frame_begin(t, TELEM_HELLO, ROM_ID_LEN);
+    if (p != NULL) {
+        memcpy(p, rom_id, ROM_ID_LEN);
+        frame_end(t);
+    }
+    ow_telem_flush(t);
+    return true;
+}
+
+void ow_telem_counters(ow_telem_t *t, const ow_stats_t *s) {
+    uint8_t *p = frame_begin(t, TELEM_COUNTERS, 8 + 11 * 4);
+    if (p == NULL) {
+        return;
+    }
+    p = put64(p, get_sim_nanos());
+    p = put32(p, s->edges);
+    p = put32(p, s->resets);
+    p = put32(p, s->forced_resets);
+    p = put32(p, s->write_slots);
+    p = put32(p, s->read_slots);
+    p = put32(p, s->not_impl);
+    p = put32(p, s->unhandled);
+    p = put32(p, s->errors);
+    p = put32(p, s->crc_updates);
+    p = put32(p, s->bytes_rx);
+    put32(p, s->bytes_tx);
+    frame_end(t);
+}
+
+void ow_telem_hist(ow_telem_t *t, uint8_t id, const ow_hist_t *h) {
+    uint8_t *p = frame_begin(t, TELEM_HIST, 1 + 6 * 4 + 8 + (OW_HIST_BINS + 2) * 4);
+    if (p == NULL) {
+        return;
+    }
+    *p++ = id;
+    p = put32(p, h->lo_ns);
+    p = put32(p, h->width_ns);
+    p = put32(p, h->count);
+    p = put32(p, h->out_of_spec);
+    p = put32(p, h->min_ns);
+    p = put32(p, h->max_ns);
+    p = put64(p, h->sum_ns);
+    for (int i = 0; i < OW_HIST_BINS + 2; i++) {
+        p = put32(p, h->bins[i]);
+    }
+    frame_end(t);
+}
+
+static void send_sm_name(ow_telem_t *t, const sm_cfg_t *cfg) {
+    if (cfg->id <= 0 || (t->sm_named >> cfg->id) & 1) {
+        return;
+    }
+    uint32_t len = strlen(cfg->name);
+    uint8_t *p = frame_begin(t, TELEM_SM_NAME, 1 + len);
+    if (p == NULL) {
+        return;
+    }
+    *p++ = cfg->id;
+    memcpy(p, cfg->name, len);
+    frame_end(t);
+    t->sm_named |= 1u << cfg->id;
+}
+
+void ow_telem_trace(ow_telem_t *t, const ow_trace_t *tr) {
+    uint32_t n = tr->count < OW_TRACE_LEN ? tr->count : OW_TRACE_LEN;
+
+    for (uint32_t i = tr->count - n; i != tr->count; i++) {
+        send_sm_name(t, tr->rec[i & (OW_TRACE_LEN - 1)].cfg);
+    }
+
+    // the whole ring does not fit a frame next to anything else, send the most recent records that do
+    uint32_t room = t->len + FRAME_OVERHEAD + 4 < OW_TELEM_BUF_LEN ? OW_TELEM_BUF_LEN - t->len - FRAME_OVERHEAD - 4 : 0;
+    if (n > room / TRACE_REC_LEN) {
+        n = room / TRACE_REC_LEN;
+    }
+    uint8_t *p = frame_begin(t, TELEM_TRACE, 4 + n * TRACE_REC_LEN);
+    if (p == NULL) {
+        return;
+    }
+    p = put32(p, tr->count);
+    for (uint32_t i = tr->count - n; i != tr->count; i++) {
+        const ow_trace_rec_t *r = &tr->rec[i & (OW_TRACE_LEN - 1)];
+        p = put64(p, r->time);
+        *p++ = r->cfg->id > 0 ? r->cfg->id : 0;
+        *p++ = r->state;
+        *p++ = r->event;
+        *p++ = r->data;
+        *p++ = r->data >> 8;
+    }
+    frame_end(t);
+}
+
+void ow_telem_flush(ow_telem_t *t) {
+    // still busy with the previous transaction, keep collecting into the same buffer
+    if (!t->enabled || t->busy || t->len == 0) {
+        return;
+    }
+    if (!uart_write(t->uart, t->buf[t->active], t->len)) {
+        return;
+    }
+    t->busy = true;
+    t->active ^= 1;
+    t->len = 0;
+}
@@ -0,0 +1,64 @@
+// Flight recorder - decoding and dump of the event ring
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_trace.h"
+#include "ow_telem.h"
+
+void ow_trace_init(ow_trace_t *t) {
+    t->count = 0;
+    t->fault = NULL;
+    t->dump_attr = attr_init("traceDump", TRACE_DUMP_ON_FAULT);
+    t->telem = NULL;
+}
+
+static const char *state_name(const sm_cfg_t *cfg, uint32_t state) {
+    for (int i = 0; i < cfg->num_entries; i++) {
+        if (cfg->sm_entries[i].state == state) return cfg->sm_entries[i].st_name;
+    }
+    return "?";
+}
+
+static const char *event_name(const sm_cfg_t *cfg, uint32_t event) {
+    for (int i = 0; i < cfg->num_entries; i++) {
+        if (cfg->sm_entries[i].event == event) return cfg->sm_entries[i].ev_name;
+    }
+    return "?";
+}
+
+void ow_trace_dump(ow_trace_t *t, const char *why) {
+    uint32_t n = t->count < OW_TRACE_LEN ? t->count : OW_TRACE_LEN;
+
+    if (t->telem != NULL) {
+        ow_telem_trace(t->telem, t);
+        return;
+    }
+    printf("*** trace dump (%s), last %u of %u events:\n", why, n, t->count);
+    for (uint32_t i = t->count - n; i != t->count; i++) {
+        const ow_trace_rec_t *r = &t->rec[i & (OW_TRACE_LEN - 1)];
+        const sm_cfg_t *cfg = r->cfg;
+        printf("  %10" PRIu64 ".%03" PRIu64 " %-16s %-34s %-24s %u\n", r->time / 1000, r->time % 1000,
+               cfg->name, state_name(cfg, r->state), event_name(cfg, r->event), r->data);
+    }
+}
+
+void ow_trace_on_state_reset(ow_trace_t *t) {
+    if (t == NULL || t->fault == NULL) {
+        return;
+    }
+    if (attr_read(t->dump_attr) >= TRACE_DUMP_ON_FAULT) {
+        ow_trace_dump(t, t->fault);
+    }
+    t->fault = NULL;
+}
+
+void ow_trace_on_reset_pulse(ow_trace_t *t) {
+    if (t != NULL && attr_read(t->dump_attr) >= TRACE_DUMP_ON_RESET) {
+        ow_trace_dump(t, "reset pulse");
+    }
+}
@@ -0,0 +1,475 @@
+// Offline 1-Wire protocol decoder - host build only
+//
+// Turns the DQ wire of a capture (VCD or the binary format of tools/vcd2cap) into transactions: the
+// reset and presence pulse, ROM command and ROM id, function command, payload bytes and CRC
+// validity. Slots are classified with the protocol timing of include/ow.h.
+//
+// The capture is split into chunks at reset pulses and the chunks are decoded on a pool of threads,
+// each transaction belongs to the chunk its reset pulse starts in. Binary captures are split by
+// their window index and each thread reads its own part of the mapping, VCD captures are read into
+// memory first. Output stays in capture order.
+//
+//   ow_decode [-w D0] [-j threads] [-c chunk ms] [-q] capture.vcd|capture.owcap
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "wokwi-api.h"
+#include "ow.h"
+#include "ow_crc.h"
+#include "vcd.h"
+#include "owcap.h"
+#include "sim.h"
+
+#define MAX_SLOTS           4096
+#define VCD_CHUNK_MIN       4096        // pulses
+
+#define RESET_MIN           _NS(PR_DUR_FORCED_RESET)
+#define PRESENCE_WAIT_MAX   (_NS(2 * PR_DUR_RESET_MASTER_RELEASE) + PR_DUR_BUS_JITTER)
+#define SLOT_1_MAX          (_NS(PR_DUR_SAMPLE_WAIT) - PR_DUR_BUS_JITTER)
+#define SLOT_MAX            (_NS(PR_DUR_SLOT_MAX) + PR_DUR_BUS_JITTER)
+
+typedef struct {
+    uint64_t fall, rise;
+} pulse_t;
+
+typedef struct {
+    uint64_t pulses, transactions, presences, crc_ok, crc_bad, bad_slots, dropped_slots;
+} counts_t;
+
+typedef struct {
+    // input, a slice of the pulse array or a time range of a binary capture
+    const pulse_t *pulses;
+    size_t num_pulses;
+    uint64_t from, to;
+
+    char *out;
+    size_t len, cap;
+    counts_t counts;
+    int done;
+} chunk_t;
+
+typedef struct {
+    chunk_t *chunk;
+    bool active;
+    bool expect_presence;
+    bool presence;
+    uint64_t time;              // reset pulse start
+    uint64_t reset_rise;
+    uint8_t slots[MAX_SLOTS / 8];
+    uint32_t num_slots;
+} txn_t;
+
+static struct {
+    const owcap_t *cap;
+    int bit;                    // DQ wire of the binary capture
+    bool quiet;
+
+    chunk_t *chunks;
+    size_t num_chunks;
+    size_t next;                // next chunk to decode
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} dec = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static void usage(void) {
+    fprintf(stderr, "usage: ow_decode [-w wire] [-j threads] [-c chunk ms] [-q] capture\n");
+    exit(2);
+}
+
+// ==================== output =========================
+
+static void emit(chunk_t *c, const char *fmt, ...) {
+    if (dec.quiet) {
+        return;
+    }
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(c->out + c->len, c->cap - c->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && c->len + n < c->cap) {
+            c->len += n;
+            return;
+        }
+        c->cap = c->cap ? c->cap * 2 + n : 4096 + n;
+        c->out = realloc(c->out, c->cap);
+        if (c->out == NULL) {
+            fprintf(stderr, "ow_decode: out of memory\n");
+            exit(1);
+        }
+    }
+}
+
+static void emit_hex(chunk_t *c, const uint8_t *buf, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) emit(c, " %02x", buf[i]);
+}
+
+static const char *rom_cmd_name(uint8_t cmd) {
+    switch (cmd) {
+        case OW_CMD_SEARCH: return "SEARCH_ROM";
+        case OW_CMD_READ: return "READ_ROM";
+        case OW_CMD_MATCH: return "MATCH_ROM";
+        case OW_CMD_SKIP: return "SKIP_ROM";
+        case OW_CMD_ALM_SEARCH: return "ALARM_SEARCH";
+        default: return NULL;
+    }
+}
+
+static const char *func_cmd_name(uint8_t cmd) {
+    switch (cmd) {
+        case DS_CMD_CONVERT: return "CONVERT_T";
+        case DS_CMD_WR_SCRATCH: return "WRITE_SCRATCHPAD";
+        case DS_CMD_RD_SCRATCH: return "READ_SCRATCHPAD";
+        case DS_CMD_CP_SCRATCH: return "COPY_SCRATCHPAD";
+        case DS_CMD_RECALL: return "RECALL_E2";
+        case DS_CMD_RD_PWD: return "READ_POWER_SUPPLY";
+        default: return NULL;
+    }
+}
+
+static void emit_cmd(chunk_t *c, const char *name, uint8_t cmd) {
+    if (name) emit(c, " %s", name);
+    else emit(c, " 0x%02x", cmd);
+}
+
+static void emit_crc(txn_t *t, bool ok) {
+    emit(t->chunk, ok ? " crc ok" : " crc BAD");
+    if (ok) t->chunk->counts.crc_ok++;
+    else t->chunk->counts.crc_bad++;
+}
+
+// ==================== transactions =========================
+
+static int slot(const txn_t *t, uint32_t i) {
+    return t->slots[i / 8] >> (i % 8) & 1;
+}
+
+// the byte made of the 8 slots from *pos, LSB first. Returns -1 if the transaction ends before
+static int take_byte(const txn_t *t, uint32_t *pos) {
+    if (*pos + 8 > t->num_slots) {
+        return -1;
+    }
+    uint8_t b = 0;
+    for (int i = 0; i < 8; i++) b |= slot(t, *pos + i) << i;
+    *pos += 8;
+    return b;
+}
+
+static void txn_finish(txn_t *t) {
+    chunk_t *c = t->chunk;
+    uint32_t pos = 0;
+    uint8_t buf[MAX_SLOTS / 8];
+    uint32_t len = 0;
+    int b;
+
+    if (!t->active) {
+        return;
+    }
+    t->active = false;
+    c->counts.transactions++;
+    c->counts.presences += t->presence;
+    emit(c, "%14.3f %s", t->time / 1e6, t->presence ? "P" : "-");
+
+    int rom = take_byte(t, &pos);
+    if (rom < 0) {
+        emit(c, " reset\n");
+        return;
+    }
+    emit_cmd(c, rom_cmd_name(rom), rom);
+
+    switch (rom) {
+        case OW_CMD_READ:
+        case OW_CMD_MATCH:
+            while (len < 8 && (b = take_byte(t, &pos)) >= 0) buf[len++] = b;
+            emit_hex(c, buf, len);
+            if (len == 8) emit_crc(t, crc8(buf, 7) == buf[7]);
+            break;
+        case OW_CMD_SEARCH:
+        case OW_CMD_ALM_SEARCH:
+            // bit, complement, direction written by the master - the direction is the id bit
+            memset(buf, 0, 8);
+            for (len = 0; len < 64 && pos + 3 <= t->num_slots; len++, pos += 3) {
+                if (slot(t, pos) && slot(t, pos + 1)) break;   // nobody answered
+                buf[len / 8] |= slot(t, pos + 2) << (len % 8);
+            }
+            emit_hex(c, buf, len / 8);
+            if (len == 64) emit_crc(t, crc8(buf, 7) == buf[7]);
+            else emit(c, " (%u bits)", len);
+            break;
+        default:
+            break;
+    }
+
+    int func = take_byte(t, &pos);
+    if (func >= 0) {
+        emit_cmd(c, func_cmd_name(func), func);
+        len = 0;
+        while ((b = take_byte(t, &pos)) >= 0) buf[len++] = b;
+        emit_hex(c, buf, len);
+        if (func == DS_CMD_RD_SCRATCH && len >= 9) emit_crc(t, crc8(buf, 8) == buf[8]);
+    }
+    if (pos < t->num_slots) emit(c, " +%u bits", t->num_slots - pos);
+    emit(c, "\n");
+}
+
+// feed a low pulse, returns true if it's a reset pulse
+static bool txn_pulse(txn_t *t, uint64_t fall, uint64_t rise) {
+    uint64_t low = rise - fall;
+
+    t->chunk->counts.pulses++;
+    if (low >= RESET_MIN) {
+        txn_finish(t);
+        t->active = true;
+        t->expect_presence = true;
+        t->presence = false;
+        t->time = fall;
+        t->reset_rise = rise;
+        t->num_slots = 0;
+        return true;
+    }
+    if (!t->active) {
+        return false;
+    }
+    if (t->expect_presence) {
+        t->expect_presence = false;
+        if (fall - t->reset_rise <= PRESENCE_WAIT_MAX) {
+            t->presence = true;
+            return false;
+        }
+    }
+    if (low > SLOT_MAX) {
+        t->chunk->counts.bad_slots++;
+    }
+    if (t->num_slots == MAX_SLOTS) {
+        t->chunk->counts.dropped_slots++;
+        return false;
+    }
+    uint32_t i = t->num_slots++;
+    if (low < SLOT_1_MAX) t->slots[i / 8] |= 1 << (i % 8);
+    else t->slots[i / 8] &= ~(1 << (i % 8));
+    return false;
+}
+
+// ==================== chunks =========================
+
+static void decode_pulses(chunk_t *c) {
+    txn_t t = {.chunk = c};
+    for (size_t i = 0; i < c->num_pulses; i++) {
+        txn_pulse(&t, c->pulses[i].fall, c->pulses[i].rise);
+    }
+    txn_finish(&t);
+}
+
+// transactions with a reset pulse starting in [from, to), the last one runs past to
+static void decode_range(chunk_t *c) {
+    txn_t t = {.chunk = c};
+    owcap_cursor_t cur;
+    uint64_t mask = 1ull << dec.bit;
+    bool low = false, known = false;
+    uint64_t fall = 0;
+
+    owcap_seek(&cur, dec.cap, c->from);
+    // a low in progress at from started in the previous chunk
+    known = cur.state & mask;
+    while (owcap_next(&cur)) {
+        if (!(cur.changed & mask)) continue;
+        if (!(cur.state & mask)) {
+            low = true;
+            known = true;
+            fall = cur.time;
+            continue;
+        }
+        if (!low || !known) {
+            low = false;
+            known = true;
+            continue;
+        }
+        low = false;
+        if (cur.time - fall >= RESET_MIN) {
+            if (fall >= c->to) break;
+            if (fall < c->from) continue;
+        } else if (!t.active) {
+            continue;
+        }
+        txn_pulse(&t, fall, cur.time);
+    }
+    txn_finish(&t);
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&dec.lock);
+        size_t i = dec.next++;
+        pthread_mutex_unlock(&dec.lock);
+        if (i >= dec.num_chunks) {
+            return NULL;
+        }
+
+        chunk_t *c = &dec.chunks[i];
+        if (dec.cap) decode_range(c);
+        else decode_pulses(c);
+
+        pthread_mutex_lock(&dec.lock);
+        c->done = 1;
+        pthread_cond_broadcast(&dec.cond);
+        pthread_mutex_unlock(&dec.lock);
+    }
+}
+
+static void add_chunk(void) {
+    dec.chunks = realloc(dec.chunks, (dec.num_chunks + 1) * sizeof(chunk_t));
+    if (dec.chunks == NULL) {
+        fprintf(stderr, "ow_decode: out of memory\n");
+        exit(1);
+    }
+    memset(&dec.chunks[dec.num_chunks++], 0, sizeof(chunk_t));
+}
+
+static void split_capture(const owcap_t *cap, uint64_t chunk_ns) {
+    const owcap_header_t *h = cap->hdr;
+    uint64_t w = h->window_ns;
+    // chunks start on window boundaries so a seek lands on an index entry
+    chunk_ns = (chunk_ns + w - 1) / w * w;
+    for (uint64_t t = h->start_ns; t <= h->end_ns; t += chunk_ns) {
+        add_chunk();
+        dec.chunks[dec.num_chunks - 1].from = t;
+        dec.chunks[dec.num_chunks - 1].to = t + chunk_ns;
+    }
+    // the first chunk takes a transaction already running when the capture starts
+    if (dec.num_chunks) dec.chunks[0].from = 0;
+}
+
+// VCD captures are read into a pulse array and split at reset pulses
+static int load_vcd(const char *path, const char *wire, pulse_t **pulses, size_t *num) {
+    vcd_reader_t vcd;
+    if (vcd_open(&vcd, path, wire) < 0) {
+        return -1;
+    }
+    pulse_t *p = NULL;
+    size_t n = 0, cap = 0;
+    uint64_t t, fall = 0;
+    int idx, value, level = HIGH;
+
+    while (vcd_next(&vcd, &t, &idx, &value)) {
+        if (value == level) continue;
+        level = value;
+        if (value == LOW) {
+            fall = t;
+            continue;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2 : 65536;
+            p = realloc(p, cap * sizeof(pulse_t));
+            if (p == NULL) {
+                fprintf(stderr, "ow_decode: out of memory\n");
+                exit(1);
+            }
+        }
+        p[n++] = (pulse_t){fall, t};
+    }
+    vcd_close(&vcd);
+    *pulses = p;
+    *num = n;
+    return 0;
+}
+
+static void split_pulses(const pulse_t *p, size_t n, size_t chunk) {
+    size_t start = 0;
+    for (size_t i = 1; i <= n; i++) {
+        bool cut = i == n || (i - start >= chunk && p[i].rise - p[i].fall >= RESET_MIN);
+        if (!cut) continue;
+        add_chunk();
+        dec.chunks[dec.num_chunks - 1].pulses = p + start;
+        dec.chunks[dec.num_chunks - 1].num_pulses = i - start;
+        start = i;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *wire = "D0";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    double chunk_ms = 0;
+    int i;
+
+    for (i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-q")) dec.quiet = true;
+        else if (!strcmp(argv[i], "-w") && i + 2 < argc) wire = argv[++i];
+        else if (!strcmp(argv[i], "-j") && i + 2 < argc) threads = atol(argv[++i]);
+        else if (!strcmp(argv[i], "-c") && i + 2 < argc) chunk_ms = atof(argv[++i]);
+        else usage();
+    }
+    if (i != argc - 1 || threads < 1) usage();
+    const char *path = argv[i];
+
+    double t0 = sim_wall_s();
+    owcap_t cap;
+    pulse_t *pulses = NULL;
+    size_t num_pulses = 0;
+    int err = owcap_open(&cap, path);
+    if (err == 0) {
+        dec.cap = &cap;
+        dec.bit = owcap_wire(&cap, wire);
+        if (dec.bit < 0) {
+            fprintf(stderr, "no wire named %s in %s\n", wire, path);
+            return 1;
+        }
+        // a few chunks per thread keeps them busy when the bus activity is uneven
+        uint64_t span = cap.hdr->end_ns - cap.hdr->start_ns;
+        uint64_t chunk_ns = chunk_ms > 0 ? (uint64_t)(chunk_ms * 1e6) : span / (threads * 8) + 1;
+        split_capture(&cap, chunk_ns);
+    } else if (err == -2) {
+        if (load_vcd(path, wire, &pulses, &num_pulses) < 0) return 1;
+        size_t chunk = num_pulses / (threads * 8);
+        split_pulses(pulses, num_pulses, chunk < VCD_CHUNK_MIN ? VCD_CHUNK_MIN : chunk);
+    } else {
+        return 1;
+    }
+    double t_load = sim_wall_s() - t0;
+
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    for (long j = 0; j < threads; j++) pthread_create(&tids[j], NULL, worker, NULL);
+
+    // write the chunks out in order as they complete
+    counts_t total = {0};
+    for (size_t j = 0; j < dec.num_chunks; j++) {
+        chunk_t *c = &dec.chunks[j];
+        pthread_mutex_lock(&dec.lock);
+        while (!c->done) pthread_cond_wait(&dec.cond, &dec.lock);
+        pthread_mutex_unlock(&dec.lock);
+
+        if (c->len) fwrite(c->out, 1, c->len, stdout);
+        free(c->out);
+        total.pulses += c->counts.pulses;
+        total.transactions += c->counts.transactions;
+        total.presences += c->counts.presences;
+        total.crc_ok += c->counts.crc_ok;
+        total.crc_bad += c->counts.crc_bad;
+        total.bad_slots += c->counts.bad_slots;
+        total.dropped_slots += c->counts.dropped_slots;
+    }
+    for (long j = 0; j < threads; j++) pthread_join(tids[j], NULL);
+    double dt = sim_wall_s() - t0;
+
+    fprintf(stderr, "%" PRIu64 " transactions, %" PRIu64 " presence pulses, crc %" PRIu64 " ok %" PRIu64 " bad, "
+                    "%" PRIu64 " out of spec slots, %" PRIu64 " slots dropped\n", total.transactions,
+            total.presences, total.crc_ok, total.crc_bad, total.bad_slots, total.dropped_slots);
+    fprintf(stderr, "%" PRIu64 " pulses in %zu chunks on %ld threads, %.3f s (%.3f s loading), %.2f M pulses/s\n",
+            total.pulses, dec.num_chunks, threads, dt, t_load, total.pulses / dt / 1e6);
+
+    free(tids);
+    free(pulses);
+    free(dec.chunks);
+    if (dec.cap) owcap_close(&cap);
+    return total.crc_bad != 0;
+}
@@ -0,0 +1,209 @@
+// chip state log to VCD - host build only
+//
+// Reads the simulator console output of a chip running with `stateLog` on, picks out the `~W`/`~S`
+// lines and writes a VCD with a multi bit wire per state variable. Given a Wokwi logic analyzer
+// export with -m, its signals are merged in so DQ and the chip states show up in one view.
+//
+//   state_vcd [-m capture.vcd] [console.log] > states.vcd
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define MAX_WIRES   8
+#define MAX_LINE    1024
+
+typedef struct {
+    char name[64];
+    char id[8];
+    unsigned bits;
+    int declared;
+} wire_t;
+
+typedef struct {
+    uint64_t time;
+    unsigned wire;
+    unsigned value;
+    size_t seq;         // keeps changes at the same time in log order
+} change_t;
+
+static wire_t wires[MAX_WIRES];
+static change_t *changes;
+static size_t num_changes, cap_changes;
+
+static void add_change(uint64_t time, unsigned wire, unsigned value) {
+    if (num_changes == cap_changes) {
+        cap_changes = cap_changes ? cap_changes * 2 : 1024;
+        changes = realloc(changes, cap_changes * sizeof(change_t));
+        if (changes == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    changes[num_changes] = (change_t){time, wire, value, num_changes};
+    num_changes++;
+}
+
+static void read_state_log(FILE *f) {
+    char line[MAX_LINE];
+    char name[64];
+    unsigned wire, bits, value;
+    uint64_t time;
+
+    while (fgets(line, sizeof(line), f)) {
+        // console lines may carry a prefix, e.g. when the log is buffered into another line
+        char *p = strstr(line, "~W ");
+        if (p && sscanf(p, "~W %u %u %63s", &wire, &bits, name) == 3 && wire < MAX_WIRES) {
+            snprintf(wires[wire].name, sizeof(wires[wire].name), "%s", name);
+            wires[wire].bits = bits;
+            wires[wire].declared = 1;
+            continue;
+        }
+        p = strstr(line, "~S ");
+        if (p && sscanf(p, "~S %" SCNu64 " %u %u", &time, &wire, &value) == 3 && wire < MAX_WIRES) {
+            add_change(time, wire, value);
+        }
+    }
+}
+
+// records of a chip are in time order already, sorting lets concatenated logs through too
+static int change_cmp(const void *a, const void *b) {
+    const change_t *ca = a, *cb = b;
+    if (ca->time != cb->time) return ca->time < cb->time ? -1 : 1;
+    return ca->seq < cb->seq ? -1 : 1;
+}
+
+static void print_value(FILE *out, const wire_t *w, unsigned v) {
+    if (w->bits == 1) {
+        fprintf(out, "%u%s\n", v & 1, w->id);
+        return;
+    }
+    fputc('b', out);
+    for (int i = w->bits - 1; i >= 0; i--) {
+        fputc(v >> i & 1 ? '1' : '0', out);
+    }
+    fprintf(out, " %s\n", w->id);
+}
+
+// copy the capture header up to $enddefinitions, returns the ids it uses (space separated)
+static int copy_capture_header(FILE *cap, FILE *out, char *ids, size_t ids_len) {
+    char line[MAX_LINE];
+    char id[32];
+
+    ids[0] = 0;
+    while (fgets(line, sizeof(line), cap)) {
+        if (strstr(line, "$enddefinitions")) {
+            return 0;
+        }
+        if (strstr(line, "$timescale") && !strstr(line, "1ns")) {
+            fprintf(stderr, "capture timescale is not 1ns: %s", line);
+            return -1;
+        }
+        if (strstr(line, "$version") || strstr(line, "$date") || strstr(line, "$timescale")) {
+            continue;
+        }
+        if (sscanf(line, " $var %*s %*s %31s", id) == 1 && strlen(ids) + strlen(id) + 3 < ids_len) {
+            strcat(ids, " ");
+            strcat(ids, id);
+            strcat(ids, " ");
+        }
+        fputs(line, out);
+    }
+    fprintf(stderr, "capture has no $enddefinitions\n");
+    return -1;
+}
+
+// next timestamp of the capture, value changes up to it are copied by copy_capture_changes
+static int next_capture_time(FILE *cap, uint64_t *time, char *pending, size_t len) {
+    while (fgets(pending, len, cap)) {
+        if (pending[0] == '#') {
+            *time = strtoull(pending + 1, NULL, 10);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void copy_capture_changes(FILE *cap, FILE *out, char *pending, size_t len) {
+    while (fgets(pending, len, cap)) {
+        if (pending[0] == '#') {
+            return;
+        }
+        if (pending[0] != '\n' && pending[0] != '\r') {
+            fputs(pending, out);
+        }
+    }
+    pending[0] = 0;
+}
+
+int main(int argc, char **argv) {
+    FILE *in = stdin, *cap = NULL, *out = stdout;
+    char ids[MAX_LINE] = {0};
+    char pending[MAX_LINE] = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            cap = fopen(argv[++i], "r");
+            if (cap == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else {
+            in = fopen(argv[i], "r");
+            if (in == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    read_state_log(in);
+    qsort(changes, num_changes, sizeof(change_t), change_cmp);
+
+    fprintf(out, "$version Generated by state_vcd $end\n$timescale 1ns $end\n");
+    if (cap != NULL && copy_capture_header(cap, out, ids, sizeof(ids)) < 0) {
+        return 1;
+    }
+
+    fprintf(out, "$scope module chip $end\n");
+    for (int i = 0; i < MAX_WIRES; i++) {
+        wire_t *w = &wires[i];
+        if (!w->declared) continue;
+        // pick an id the capture does not use
+        char key[16];
+        for (int n = 0; ; n++) {
+            snprintf(w->id, sizeof(w->id), n ? "S%d_%d" : "S%d", i, n);
+            snprintf(key, sizeof(key), " %s ", w->id);
+            if (!strstr(ids, key)) break;
+        }
+        fprintf(out, "$var wire %u %s %s $end\n", w->bits, w->id, w->name);
+    }
+    fprintf(out, "$upscope $end\n$enddefinitions $end\n");
+
+    uint64_t cap_time = 0;
+    int cap_more = cap != NULL && next_capture_time(cap, &cap_time, pending, sizeof(pending));
+    size_t c = 0;
+
+    while (c < num_changes || cap_more) {
+        uint64_t t = c < num_changes ? changes[c].time : UINT64_MAX;
+        if (cap_more && cap_time < t) t = cap_time;
+
+        fprintf(out, "#%" PRIu64 "\n", t);
+        // the capture repeats timestamps, take everything up to the next different one
+        while (cap_more && cap_time == t) {
+            copy_capture_changes(cap, out, pending, sizeof(pending));
+            cap_more = pending[0] == '#';
+            if (cap_more) cap_time = strtoull(pending + 1, NULL, 10);
+        }
+        for (; c < num_changes && changes[c].time == t; c++) {
+            const wire_t *w = &wires[changes[c].wire];
+            if (w->declared) print_value(out, w, changes[c].value);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// VCD to binary capture converter - host build only
+//
+// Converts the scalar wires of a logic analyzer export to the binary capture format of
+// host/owcap.h, which the host tools map and read without parsing text. -d writes a capture back
+// out as VCD, -i prints its header and index.
+//
+//   vcd2cap [-W window us] capture.vcd capture.owcap
+//   vcd2cap -d capture.owcap > capture.vcd
+//   vcd2cap -i capture.owcap
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "vcd.h"
+#include "owcap.h"
+
+static void usage(void) {
+    fprintf(stderr, "usage: vcd2cap [-W window us] capture.vcd capture.owcap\n"
+                    "       vcd2cap -d capture.owcap\n"
+                    "       vcd2cap -i capture.owcap\n");
+    exit(2);
+}
+
+static int convert(const char *in, const char *out, uint64_t window_ns) {
+    vcd_reader_t vcd;
+    if (vcd_open(&vcd, in, NULL) < 0) {
+        return 1;
+    }
+
+    char names[VCD_MAX_WIRES][OWCAP_NAME_LEN];
+    for (int i = 0; i < vcd.num_wires; i++) snprintf(names[i], OWCAP_NAME_LEN, "%s", vcd.wires[i].name);
+    // wires are high until their first value, like the pulled up bus
+    uint64_t state = vcd.num_wires == 64 ? ~0ull : (1ull << vcd.num_wires) - 1;
+
+    owcap_writer_t w;
+    if (owcap_create(&w, out, names, vcd.num_wires, window_ns, state) < 0) {
+        vcd_close(&vcd);
+        return 1;
+    }
+    uint64_t t;
+    int wire, value;
+    while (vcd_next(&vcd, &t, &wire, &value)) {
+        state = (state & ~(1ull << wire)) | (uint64_t)value << wire;
+        if (owcap_write(&w, t, state) < 0) break;
+    }
+    vcd_close(&vcd);
+    if (owcap_finish(&w) < 0) {
+        fprintf(stderr, "%s: write failed\n", out);
+        return 1;
+    }
+    fprintf(stderr, "%s: %d wires, %" PRIu64 " changes -> %" PRIu64 " records, %" PRIu64 " windows\n", out,
+            vcd.num_wires, vcd.changes, w.hdr.num_records, w.hdr.num_windows);
+    return 0;
+}
+
+static int dump(const char *path) {
+    owcap_t cap;
+    if (owcap_open(&cap, path) < 0) {
+        fprintf(stderr, "%s: not a capture\n", path);
+        return 1;
+    }
+    uint32_t n = cap.hdr->num_wires;
+
+    printf("$timescale 1ns $end\n$scope module logic $end\n");
+    for (uint32_t i = 0; i < n; i++) printf("$var wire 1 %c %.*s $end\n", '!' + i, OWCAP_NAME_LEN, cap.names[i]);
+    printf("$upscope $end\n$enddefinitions $end\n");
+
+    owcap_cursor_t cur;
+    owcap_seek(&cur, &cap, 0);
+    printf("#0\n");
+    for (uint32_t i = 0; i < n; i++) printf("%d%c\n", (int)(cur.state >> i & 1), '!' + i);
+    while (owcap_next(&cur)) {
+        printf("#%" PRIu64 "\n", cur.time);
+        for (uint32_t i = 0; i < n; i++) {
+            if (cur.changed >> i & 1) printf("%d%c\n", (int)(cur.state >> i & 1), '!' + i);
+        }
+    }
+    owcap_close(&cap);
+    return 0;
+}
+
+static int info(const char *path) {
+    owcap_t cap;
+    if (owcap_open(&cap, path) < 0) {
+        fprintf(stderr, "%s: not a capture\n", path);
+        return 1;
+    }
+    const owcap_header_t *h = cap.hdr;
+
+    printf("%s: %" PRIu64 " bytes, %u wires:", path, (uint64_t)cap.size, h->num_wires);
+    for (uint32_t i = 0; i < h->num_wires; i++) printf(" %.*s", OWCAP_NAME_LEN, cap.names[i]);
+    printf("\n%" PRIu64 " records over %.3f ms from %.3f ms, %.2f bytes/record\n", h->num_records,
+           (h->end_ns - h->start_ns) / 1e6, h->start_ns / 1e6, h->num_records ? (double)h->data_len / h->num_records : 0);
+    printf("%" PRIu64 " windows of %.3f ms\n", h->num_windows, h->window_ns / 1e6);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    uint64_t window_ns = OWCAP_DEF_WINDOW;
+    int i = 1;
+
+    if (argc == 3 && !strcmp(argv[1], "-d")) return dump(argv[2]);
+    if (argc == 3 && !strcmp(argv[1], "-i")) return info(argv[2]);
+    if (argc > 2 && !strcmp(argv[1], "-W")) {
+        window_ns = (uint64_t)(atof(argv[2]) * 1000);
+        i = 3;
+    }
+    if (argc - i != 2 || window_ns == 0) usage();
+    return convert(argv[i], argv[i + 1], window_ns);
+}
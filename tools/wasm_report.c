@@ -0,0 +1,123 @@
+// wasm module size report - host build only, run by `make report`
+//
+// Walks the sections of a wasm module and prints the module size, function counts and the
+// space taken by code, data and custom (name/debug) sections.
+//
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Bonny Rais
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define WASM_SEC_CUSTOM     0
+#define WASM_SEC_IMPORT     2
+#define WASM_SEC_FUNCTION   3
+#define WASM_SEC_EXPORT     7
+#define WASM_SEC_CODE       10
+#define WASM_SEC_DATA       11
+
+#define WASM_KIND_FUNC      0
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} reader_t;
+
+static uint32_t rd_leb(reader_t *r) {
+    uint32_t v = 0;
+    for (int shift = 0; r->p < r->end; shift += 7) {
+        uint8_t b = *r->p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static void skip_name(reader_t *r) {
+    uint32_t len = rd_leb(r);
+    r->p += len;
+}
+
+// count imported functions, skipping the other import kinds
+static uint32_t count_func_imports(reader_t r) {
+    uint32_t n = rd_leb(&r), funcs = 0;
+    for (uint32_t i = 0; i < n && r.p < r.end; i++) {
+        skip_name(&r);
+        skip_name(&r);
+        uint8_t kind = *r.p++;
+        switch (kind) {
+            case 0: rd_leb(&r); funcs++; break;                             // type index
+            case 1: r.p++; if (*r.p++ & 1) { rd_leb(&r); } rd_leb(&r); break; // table: elem type, limits
+            case 2: if (*r.p++ & 1) { rd_leb(&r); } rd_leb(&r); break;      // memory limits
+            case 3: r.p += 2; break;                                        // global: type, mut
+            default: return funcs;
+        }
+    }
+    return funcs;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <module.wasm>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(size);
+    if (fread(buf, 1, size, f) != (size_t)size) {
+        perror(argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    if (size < 8 || memcmp(buf, "\0asm", 4) != 0) {
+        fprintf(stderr, "%s: not a wasm module\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t funcs = 0, imports = 0, exports = 0;
+    uint32_t code_size = 0, data_size = 0, custom_size = 0;
+    reader_t r = { buf + 8, buf + size };
+
+    printf("wasm report: %s\n", argv[1]);
+    while (r.p < r.end) {
+        uint8_t id = *r.p++;
+        uint32_t len = rd_leb(&r);
+        reader_t sec = { r.p, r.p + len };
+
+        switch (id) {
+            case WASM_SEC_IMPORT: imports = count_func_imports(sec); break;
+            case WASM_SEC_FUNCTION: funcs = rd_leb(&sec); break;
+            case WASM_SEC_EXPORT: exports = rd_leb(&sec); break;
+            case WASM_SEC_CODE: code_size = len; break;
+            case WASM_SEC_DATA: data_size = len; break;
+            case WASM_SEC_CUSTOM: {
+                uint32_t name_len = rd_leb(&sec);
+                printf("  custom section %-22.*s %8u bytes\n", (int)name_len, sec.p, len);
+                custom_size += len;
+                break;
+            }
+        }
+        r.p += len;
+    }
+
+    printf("  module size                  %8ld bytes\n", size);
+    printf("  code section                 %8u bytes\n", code_size);
+    printf("  data section                 %8u bytes\n", data_size);
+    printf("  custom sections              %8u bytes\n", custom_size);
+    printf("  functions defined            %8u\n", funcs);
+    printf("  functions imported           %8u\n", imports);
+    printf("  exports                      %8u\n", exports);
+
+    free(buf);
+    return 0;
+}